@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Audio block size and sample rate, latency against CPU
+ * Small blocks answer keys and MIDI sooner but pay the callback overhead
+ * more often, big blocks are the cheapest. Hardware-free, the firmware
+ * switches with FieldWrap::SetAudioProfile, the host tools profile them
+ */
+struct AudioProfile {
+  const char *name;
+  size_t blockSize;
+  float sampleRate;
+
+  enum {
+    PROFILE_4_48K,
+    PROFILE_16_48K,
+    PROFILE_32_48K, // default
+    PROFILE_64_48K,
+    PROFILE_256_32K,
+    PROFILE_32_96K,
+    PROFILE_64_96K,
+    PROFILE_LAST
+  };
+  static constexpr uint8_t defaultProfile_ = PROFILE_32_48K;
+
+  // out of range is the default
+  static const AudioProfile &Get(uint8_t profile) {
+    static const AudioProfile profiles[PROFILE_LAST] = {
+        {"4/48k", 4, 48000.0f},     {"16/48k", 16, 48000.0f},
+        {"32/48k", 32, 48000.0f},   {"64/48k", 64, 48000.0f},
+        {"256/32k", 256, 32000.0f}, {"32/96k", 32, 96000.0f},
+        {"64/96k", 64, 96000.0f}};
+    return profiles[profile < PROFILE_LAST ? profile : defaultProfile_];
+  }
+
+  // one block, the latency the block size adds
+  float BlockMs() const { return 1000.0f * blockSize / sampleRate; }
+};
@@ -2,6 +2,9 @@
 
 #pragma once
 #include "utilities.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 
 class Clock {
 public:
@@ -32,13 +35,87 @@ public:
     return false;
   };
 
+  // a tick inside a block
+  struct Tick {
+    // sample the tick is handled on
+    uint16_t offset;
+    // how far before that sample the phase actually wrapped, 0 to 1
+    float frac;
+  };
+
+  /**
+   * Moves the clock forward by a whole block, ticks are worked out from
+   * the phase and increment instead of checked every sample
+   * Same ticks as calling Process size times
+   *
+   * @param size block size in samples
+   * @param ticks filled with the ticks in the block, in order
+   * @param maxTicks size of ticks
+   * @param done if not nullptr, samples the clock moved, less than size
+   * when ticks is full: the clock stops just before the first tick that
+   * doesn't fit, call again for the rest. If nullptr, extra ticks are
+   * dropped
+   * @return size_t number of ticks
+   */
+  size_t ProcessBlock(size_t size, Tick *ticks, size_t maxTicks,
+                      size_t *done = nullptr) {
+    size_t count = 0;
+    size_t wraps = 0;
+    if (phaseIncr_ > 0.0f) {
+      // samples until the phase wraps, fractional
+      double next = (TWOPI_F - phase_) / phaseIncr_;
+      double period = TWOPI_F / phaseIncr_;
+      // a hair of tolerance, for phases set just before the end
+      double tolerance = 1e-4 + 1e-6 / phaseIncr_;
+      for (; next - tolerance < size; next += period, wraps++) {
+        float sample = ceil(next - tolerance);
+        sample = sample < 1.0f ? 1.0f : sample;
+        // Process ticks on the sample that crosses, that's sample - 1
+        uint16_t offset = static_cast<uint16_t>(sample) - 1;
+        if (count == maxTicks) {
+          if (done && offset > 0) {
+            // stop right before it, it's the first tick of the next call
+            size = offset;
+            break;
+          }
+          // dropped, the phase still goes past it
+          continue;
+        }
+        ticks[count].offset = offset;
+        ticks[count].frac = sample - next < 0.0f ? 0.0f : sample - next;
+        count++;
+      }
+    }
+    if (done) {
+      *done = size;
+    }
+    // the phase has to agree with the ticks, or the next block ticks twice
+    phase_ += static_cast<double>(phaseIncr_) * size - TWOPI_F * wraps;
+    if (phase_ < 0.0f) {
+      // ticked a hair early
+      phase_ = 0.0f;
+    } else if (phase_ >= TWOPI_F) {
+      // a hair late, tick on the first sample of the next block
+      SetPhaseToEnd();
+    }
+    return count;
+  }
+
   float GetBpm() { return freq_ * 60.f; }
+  uint8_t GetMultIndex() { return multIndex_; }
+  float GetFreq() { return freq_; }
 
   void SetFreq(float freq) {
     freq_ = freq;
     phaseIncr_ = calcPhaseIncr();
   };
 
+  // keeps phase and tempo, only the increment changes
+  void SetSampleRate(float sr) {
+    sr_ = sr;
+    phaseIncr_ = calcPhaseIncr();
+  }
+
   void SetMult(uint8_t multIndex) {
     // clamp
     // value = (value < min) ? min : (value > max ? max : value);
@@ -49,6 +126,29 @@ public:
     phaseIncr_ = calcPhaseIncr();
   };
 
+  /**
+   * Follows an external clock for the next block, call before every block
+   * Speed comes from the external clock, the phase error is spread over
+   * the block instead of jumping, so ticks are never doubled or skipped,
+   * and it never runs backwards
+   *
+   * @param beats position of the external clock at the start of the block,
+   * in quarter notes
+   * @param beatsPerSample speed of the external clock
+   * @param size block size in samples
+   */
+  void Sync(float beats, float beatsPerSample, size_t size) {
+    freq_ = beatsPerSample * sr_;
+    float ticks = beats * mult_;
+    float target = (ticks - floorf(ticks)) * TWOPI_F;
+    // shortest way round
+    float error = target - phase_;
+    error = error > PI_F ? error - TWOPI_F : error;
+    error = error < -PI_F ? error + TWOPI_F : error;
+    phaseIncr_ = calcPhaseIncr() + error / size;
+    phaseIncr_ = phaseIncr_ < 0.0f ? 0.0f : phaseIncr_;
+  }
+
   /**
    * Sets phase to the end so that the next process will be a reset
    */
@@ -57,15 +157,21 @@ public:
   /**
    * Clock multiplier character for printing on screen
    */
-  const char *GetMultChar() { return multChar_[multIndex_]; }
+  const char *GetMultChar() { return MultIndexToChar(multIndex_); }
+  // same for any index, eg a preset's, out of range is x1
+  static const char *MultIndexToChar(uint8_t multIndex) {
+    static const char *const multChars[11] = {
+        "/16", "/8", "/4", "/3", "/2", "", "x2", "x3", "x4", "x8", "x16"};
+    return multChars[multIndex < 11 ? multIndex : 5];
+  }
 
 private:
-  float freq_, mult_, phase_, sr_, phaseIncr_;
+  float freq_, mult_, sr_, phaseIncr_;
+  // double, float rounding adds up to audible tempo errors at slow rates
+  double phase_;
   uint8_t multIndex_;
   float mults_[11] = {1.0f / 16, 1.0f / 8, 1.0f / 4, 1.0f / 3, 1.0f / 2, 1.0f,
                       2.0f,      3.0f,     4.0f,     8.0f,     16.0f};
-  const char *multChar_[11] = {"/16", "/8", "/4", "/3", "/2", "",
-                               "x2",  "x3", "x4", "x8", "x16"};
 
   // calculates phase increment per sample
   float calcPhaseIncr() { return (TWOPI_F * freq_ * mult_) / sr_; };
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Runs a modulation source at control rate, once every "interval"
+ * samples, and ramps linearly between its values for the audio rate
+ * consumer (eg an envelope on the filter cutoff, that only moves through
+ * the table in steps anyway). The source runs at sr / interval, so its
+ * times stay the same and it costs about 1 / interval
+ * Sources for amplitude stay at audio rate, the ramp would smear clicks
+ * Interval 1 is the same as running the source directly
+ *
+ * @tparam Source needs float Process() and SetSampleRate(float), and
+ * Trigger(float) only if Trigger is called here
+ */
+template <typename Source> class ControlRate {
+public:
+  ControlRate() {}
+  ~ControlRate() {}
+
+  // max interval, in samples
+  static constexpr size_t maxInterval_ = 256;
+
+  /**
+   * Takes over the source's sample rate, the source still belongs to the
+   * caller, settings go straight to it
+   *
+   * @param source what to run, eg an Envelope after Init
+   * @param sr audio sample rate
+   * @param interval samples between source updates
+   */
+  void Init(Source *source, float sr, size_t interval) {
+    source_ = source;
+    sr_ = sr;
+    value_ = target_ = step_ = 0.0f;
+    countdown_ = 0;
+    SetInterval(interval);
+  }
+
+  // the source keeps going from where it is, at the new rate
+  void SetInterval(size_t interval) {
+    interval = interval < 1 ? 1 : interval;
+    interval_ = interval > maxInterval_ ? size_t(maxInterval_) : interval;
+    source_->SetSampleRate(sr_ / interval_);
+    // a ramp in progress keeps its step, cut short if the interval is
+    // shorter now
+    countdown_ = countdown_ > interval_ ? interval_ : countdown_;
+  }
+  size_t GetInterval() { return interval_; }
+
+  void SetSampleRate(float sr) {
+    sr_ = sr;
+    source_->SetSampleRate(sr_ / interval_);
+  }
+
+  // triggers the source and updates on the next sample, so the ramp
+  // starts right on the trigger instead of up to an interval later
+  // late is in audio samples, see Envelope::Trigger
+  void Trigger(float late = 0.0f) {
+    source_->Trigger(late / interval_);
+    countdown_ = 0;
+  }
+
+  /**
+   * Renders a block at audio rate
+   * The output ramps to every new source value over one interval, so it
+   * lags the source by up to an interval
+   *
+   * @param out buffer to write to
+   * @param size number of samples
+   */
+  void ProcessBlock(float *out, size_t size) {
+    size_t i = 0;
+    while (i < size) {
+      if (countdown_ == 0) {
+        target_ = source_->Process();
+        step_ = (target_ - value_) / interval_;
+        countdown_ = interval_;
+      }
+      size_t n = size - i < countdown_ ? size - i : countdown_;
+      float value = value_;
+      for (size_t j = 0; j < n; j++) {
+        value += step_;
+        out[i + j] = value;
+      }
+      countdown_ -= n;
+      i += n;
+      // ends exactly on the source value, no drift from adding steps
+      if (countdown_ == 0) {
+        value = target_;
+        out[i - 1] = value;
+      }
+      value_ = value;
+    }
+  }
+
+private:
+  Source *source_;
+  float sr_;
+  size_t interval_;
+  // output and where it's ramping to, per sample
+  float value_, target_, step_;
+  // samples until the next source update
+  size_t countdown_;
+};
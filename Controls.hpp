@@ -0,0 +1,158 @@
+#pragma once
+
+#include "SpscQueue.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// a knob moved
+struct KnobEvent {
+  uint8_t id;
+  // 0 to 1, already normalized to the knob's real travel
+  float value;
+  // ms
+  uint32_t time;
+};
+
+/**
+ * Turns raw knob readings into change events
+ * Every knob is checked on every scan, a knob only reports when it moved
+ * further than the hysteresis from the last value it reported, so noise
+ * doesn't make events
+ *
+ * @tparam Knobs number of knobs, power of 2 (for the queue)
+ */
+template <size_t Knobs> class KnobScanner {
+public:
+  KnobScanner() {}
+  ~KnobScanner() {}
+
+  /**
+   * @param minRaw raw reading at the knob's minimum
+   * @param maxRaw raw reading at the knob's maximum
+   * @param hysteresis in raw units
+   * @param settleMs scans up to this long after the first one only take
+   * where the knobs are, no events (eg while the ADC filters settle). The
+   * first scan always does, so a preset loaded at boot isn't overwritten
+   * by the knob positions, a knob reports once it's moved
+   */
+  void Init(float minRaw, float maxRaw, float hysteresis,
+            uint32_t settleMs = 0) {
+    minRaw_ = minRaw;
+    rawToNorm_ = 1.0f / (maxRaw - minRaw);
+    hysteresis_ = hysteresis;
+    settleMs_ = settleMs;
+    started_ = false;
+    for (size_t i = 0; i < Knobs; i++) {
+      reported_[i] = 0.0f;
+      values_[i] = 0.0f;
+    }
+  }
+
+  /**
+   * Checks one knob, call it for all of them on every scan
+   *
+   * @param id knob
+   * @param raw current reading
+   * @param time ms, for the event
+   * @return bool true if it made an event
+   */
+  bool Scan(uint8_t id, float raw, uint32_t time) {
+    if (!started_) {
+      started_ = true;
+      startTime_ = time;
+    }
+    // the baseline, taken without events
+    bool settling = time - startTime_ <= settleMs_;
+    if (!settling && fabsf(raw - reported_[id]) <= hysteresis_) {
+      return false;
+    }
+    reported_[id] = raw;
+    float norm = (raw - minRaw_) * rawToNorm_;
+    values_[id] = (norm < 0.0f) ? 0.0f : (norm > 1.0f ? 1.0f : norm);
+    if (settling) {
+      return false;
+    }
+    KnobEvent event = {id, values_[id], time};
+    // never full if events are read every scan, if it is the value is
+    // still in GetValue
+    events_.Push(event);
+    return true;
+  }
+
+  // oldest change first, false if there are none
+  bool PopEvent(KnobEvent &event) { return events_.Pop(event); }
+
+  // normalized, 0 to 1
+  float GetValue(uint8_t id) const { return values_[id]; }
+
+private:
+  float minRaw_, rawToNorm_, hysteresis_;
+  uint32_t settleMs_, startTime_;
+  bool started_;
+  float reported_[Knobs];
+  float values_[Knobs];
+  // room for every knob twice
+  SpscQueue<KnobEvent, 2 * Knobs> events_;
+};
+
+/**
+ * Maps a normalized knob value to a parameter's range
+ * The mapping is set up once, so log ranges cost an expf and a sqrtf per
+ * change instead of logf, expf and powf on every read. The last output is
+ * kept, integer ranges only report when the integer changes
+ */
+class KnobRange {
+public:
+  KnobRange() {}
+  ~KnobRange() {}
+
+  enum { RANGE_LINEAR, RANGE_LOG, RANGE_INT, RANGE_LAST };
+
+  /**
+   * @param min output at 0
+   * @param max output at 1
+   * @param type RANGE_LINEAR, RANGE_LOG (min has to be > 0) or RANGE_INT
+   * (linear, truncated)
+   */
+  void Init(float min, float max, uint8_t type = RANGE_LINEAR) {
+    type_ = type < RANGE_LAST ? type : RANGE_LINEAR;
+    if (type_ == RANGE_LOG) {
+      offset_ = logf(min);
+      range_ = logf(max) - offset_;
+    } else {
+      offset_ = min;
+      range_ = max - min;
+    }
+    // not a number, so the first Set always reports
+    out_ = NAN;
+  }
+
+  float Scale(float norm) const {
+    if (type_ == RANGE_LOG) {
+      // the square root shapes the curve, same as ScaleKnob
+      return expf(offset_ + sqrtf(norm) * range_);
+    }
+    float out = offset_ + norm * range_;
+    return type_ == RANGE_INT ? static_cast<int>(out) : out;
+  }
+
+  /**
+   * @param norm knob value, 0 to 1
+   * @return bool true if the output changed
+   */
+  bool Set(float norm) {
+    float out = Scale(norm);
+    if (out == out_) {
+      return false;
+    }
+    out_ = out;
+    return true;
+  }
+
+  float Get() const { return out_; }
+
+private:
+  uint8_t type_;
+  float offset_, range_, out_;
+};
@@ -1,14 +1,13 @@
-#include "Clock.hpp"
-#include "Envelope.hpp"
+#include "Controls.hpp"
+#include "Display.hpp"
 #include "FieldWrap.hpp"
-#include "Filter.hpp"
-#include "Oscillator.hpp"
-#include "PitchSequencer.hpp"
-#include "TriggerSequencer.hpp"
+#include "Patch.hpp"
+#include "PresetStore.hpp"
+#include "QspiStorage.hpp"
 #include "daisy_field.h"
 
 #define MAIN_DELAY 5 // ms, main loop iteration time (separate from audio)
-#define DISPLAY_UPDATE_DELAY 10 // update display every x main iterations
+#define DISPLAY_UPDATE_DELAY 4  // update display every x main iterations
 #define LEDS_UPDATE_DELAY 2     // update LEDs every x main iterations
 
 using namespace std;
@@ -16,108 +15,65 @@ using namespace daisy;
 
 FieldWrap hw;
 
-Clock clock;
-TriggerSequencer seq1;
-TriggerSequencer seq2;
-PitchSequencer pitchSeq;
-Oscillator osc;
-Filter filter1;
-Filter filter2;
-Envelope env1;
-Envelope env2;
+// everything that makes sound, see Patch.hpp
+Patch patch;
 
-// play/pause
-bool play = false;
+// the last state, saved in the background, restored at boot
+QspiStorage flash;
+PresetStore<QspiStorage> presets;
 
 /**
  * AUDIO CALLBACK
  */
 
-// audio
-float out1, out2;
 // for CPU %
 float cpuUsage = 0.f;
-// count step time for blinking LEDs
-uint16_t stepTime = 0;
-//
-void ResetAllSeqs() {
-  // sequencer advances before step is processed,
-  // so you need to set it to the last step when starting
-  seq1.SetCurrentStep(7);
-  seq2.SetCurrentStep(7);
-  pitchSeq.SetCurrentStep(7);
-  // set phase to end so that you don't have to wait for the next tick
-  clock.SetPhaseToEnd();
-  stepTime = 0;
-}
+// samples since boot, timestamps for the midi clock
+uint32_t sampleTime = 0;
+
 void AudioCallback(AudioHandle::InputBuffer in, AudioHandle::OutputBuffer out,
                    size_t size) {
 
   // for CPU %
   uint32_t start = System::GetTick();
 
-  // midi clock (bpm is set in main)
-  hw.ProcessMidiClock();
+  // midi clock, pulses are timestamped with the start of the block
+  hw.ProcessMidiClock(sampleTime);
 
   if (hw.UsingMidiClock()) {
     bool midiIsPlaying = hw.MidiIsPlaying();
-    if (!play && midiIsPlaying) {
-      ResetAllSeqs();
-      play = true;
+    if (!patch.play && midiIsPlaying) {
+      patch.ResetAllSeqs();
+      patch.play = true;
+    }
+    if (patch.play && !midiIsPlaying) {
+      patch.play = false;
     }
-    if (play && !midiIsPlaying) {
-      play = false;
+    // ticks land on the pulses instead of free running at the midi bpm
+    if (hw.MidiClockLocked()) {
+      const MidiClockFollower &midiClock = hw.GetMidiClockFollower();
+      patch.SyncClock(midiClock.GetBeats(sampleTime),
+                      midiClock.GetBeatsPerSample());
     }
   }
 
-  // buffer loop
-  for (size_t i = 0; i < size; i++) {
-
-    if (play) {
-
-      if (clock.Process()) {
-
-        // sequencers
-        seq1.Advance();
-        seq2.Advance();
-        pitchSeq.Advance();
-        // seq2 resets seq1
-        if (seq2.IsCurrentStepActive()) {
-          seq1.SetCurrentStep(0);
-          pitchSeq.SetCurrentStep(0);
-        }
-        // seq1 = group A = 7 to 15, makes no sense
-        hw.BlinkKeyLed(seq1.GetCurrentStep() + 8);
-        hw.BlinkKeyLed(seq2.GetCurrentStep());
-
-        // start step
-        stepTime = 0;
-
-        if (seq1.IsCurrentStepActive()) {
-          env1.Trigger();
-          env2.Trigger();
-          // set oscillator frequency
-          osc.SetFreq(pitchSeq.GetCurrentNoteHertz());
-        }
-      }
+  if (patch.Process(out[0], out[1], size)) {
+    // tracks with a divider don't move on every tick
+    if (patch.TrackMoved(Patch::TRACK_SEQ1)) {
+      hw.BlinkStepLed('A', patch.seq1.GetCurrentStep());
+    }
+    if (patch.TrackMoved(Patch::TRACK_SEQ2)) {
+      hw.BlinkStepLed('B', patch.seq2.GetCurrentStep());
     }
-
-    float env1Out = env1.Process();
-    float env2Out = env2.Process();
-    osc.SetAmp(env1Out);
-    osc.Process(&out1, &out2);
-    filter1.AddFreq(env2Out);
-    filter2.AddFreq(env2Out);
-    out1 = filter1.Process(out1 * 0.50f);
-    out2 = filter2.Process(out2 * 0.50f);
-
-    out[0][i] = out1;
-    out[1][i] = out2;
   }
 
-  stepTime++;
+  // time spent in the callback against the duration of the block
+  float elapsed = (System::GetTick() - start) /
+                  static_cast<float>(System::GetTickFreq());
+  float blockTime = size / hw.Field().AudioSampleRate();
+  cpuUsage += 0.03f * ((elapsed / blockTime * 100.f) - cpuUsage);
 
-  cpuUsage += 0.03f * (((System::GetTick() - start) / 200.f) - cpuUsage);
+  sampleTime += size;
 }
 
 /**
@@ -126,23 +82,29 @@ void AudioCallback(AudioHandle::InputBuffer in, AudioHandle::OutputBuffer out,
 
 int main(void) {
 
-  // Init stuff
-  hw.Init(AudioCallback);
+  // Init stuff, the patch (and what was saved) before the audio starts
+  hw.Init(AudioCallback, [](float sr) {
+    // the SVF needs no table, the preset picks the core afterwards, so
+    // the biquad table is only built if it's used
+    patch.Init(sr, Filter::CORE_SVF);
+    flash.Init(&hw.Field().seed.qspi);
+    presets.Init(&flash);
+    Preset preset = patch.GetPreset();
+    preset.filterCore = Filter::CORE_BIQUAD;
+    presets.Load(preset);
+    patch.LoadPreset(preset);
+  });
   hw.InitMidi();
-  clock.Init(2, hw.Field().AudioSampleRate());
-  seq1.Init(8);
-  seq2.Init(8);
-  pitchSeq.Init(8);
-  osc.Init(hw.Field().AudioSampleRate());
-  osc.SetMode(Oscillator::MODE_SAW);
-  filter1.Init(hw.Field().AudioSampleRate());
-  filter2.Init(hw.Field().AudioSampleRate());
-  env1.Init(hw.Field().AudioSampleRate());
-  env2.Init(hw.Field().AudioSampleRate());
+  uint32_t presetChanges = patch.GetPresetChanges();
+  // keys show the steps, seq1 on group A, seq2 on B, see the preset saving
+  hw.SetStepLeds('A', patch.GetPreset().seq1);
+  hw.SetStepLeds('B', patch.GetPreset().seq2);
 
   // shift buttons
   bool shift1 = false;
   bool shift2 = false;
+  // a key or knob was used while shift 2 was held, see the play toggle
+  bool shift2Used = false;
   // main loop iterations
   uint8_t mainCount = 0;
   // y position of text rows on screen
@@ -155,15 +117,100 @@ int main(void) {
   uint8_t row7 = 56;
   // offset text on string to the right to center
   uint8_t screenOffset = 6;
+
+  // what every knob does in each shift state, see Knobs below
+  enum { KNOBS_MAIN, KNOBS_SHIFT1, KNOBS_SHIFT2, KNOBS_TRACKS, KNOBS_LAST };
+  struct KnobDest {
+    uint8_t param;
+    KnobRange range;
+  };
+  KnobDest knobDests[KNOBS_LAST][8];
+  for (size_t page = 0; page < KNOBS_LAST; page++) {
+    for (size_t i = 0; i < 8; i++) {
+      // nothing
+      knobDests[page][i].param = Patch::PARAM_LAST;
+    }
+  }
+  auto setKnob = [&](uint8_t page, uint8_t i, uint8_t param, float min,
+                     float max, uint8_t type) {
+    knobDests[page][i].param = param;
+    knobDests[page][i].range.Init(min, max, type);
+  };
+  // no shift
+  setKnob(KNOBS_MAIN, 0, Patch::PARAM_TRANSPOSE, -24.0f, 24.0f,
+          KnobRange::RANGE_INT);
+  setKnob(KNOBS_MAIN, 1, Patch::PARAM_ENV1_ATTACK, 0.001f, 5.0f,
+          KnobRange::RANGE_LOG);
+  setKnob(KNOBS_MAIN, 2, Patch::PARAM_ENV1_DECAY, 0.001f, 5.0f,
+          KnobRange::RANGE_LOG);
+  setKnob(KNOBS_MAIN, 3, Patch::PARAM_FILTER_FREQ, 0.0f, 1.0f,
+          KnobRange::RANGE_LINEAR);
+  setKnob(KNOBS_MAIN, 4, Patch::PARAM_FILTER_Q, 0.0f, 1.0f,
+          KnobRange::RANGE_LINEAR);
+  setKnob(KNOBS_MAIN, 5, Patch::PARAM_ENV2_ATTACK, 0.001f, 5.0f,
+          KnobRange::RANGE_LOG);
+  setKnob(KNOBS_MAIN, 6, Patch::PARAM_ENV2_DECAY, 0.001f, 5.0f,
+          KnobRange::RANGE_LOG);
+  setKnob(KNOBS_MAIN, 7, Patch::PARAM_ENV2_SCALE, 0.0f, 1.0f,
+          KnobRange::RANGE_LINEAR);
+  // shift 1, bpm (from 20 to 220) and bpm mult
+  setKnob(KNOBS_SHIFT1, 0, Patch::PARAM_CLOCK_FREQ, 20.0f, 220.9f,
+          KnobRange::RANGE_INT);
+  setKnob(KNOBS_SHIFT1, 1, Patch::PARAM_CLOCK_MULT, 0.0f, 10.9f,
+          KnobRange::RANGE_INT);
+  // shift 2, notes are from 21 to 108, see Quantizer class
+  for (size_t i = 0; i < 8; i++) {
+    setKnob(KNOBS_SHIFT2, i, Patch::PARAM_NOTE + i, 21.0f, 108.0f,
+            KnobRange::RANGE_INT);
+  }
+  // both shifts, track lengths, dividers and directions, seq1 fill
+  const float maxLength = TriggerSequencer::maxSteps_ + 0.9f;
+  const float maxDivider = StepCounter::maxDivider_ + 0.9f;
+  const float maxDirection = StepCounter::DIR_LAST - 0.1f;
+  setKnob(KNOBS_TRACKS, 0, Patch::PARAM_LENGTH + Patch::TRACK_SEQ1, 1.0f,
+          maxLength, KnobRange::RANGE_INT);
+  setKnob(KNOBS_TRACKS, 1, Patch::PARAM_FILL + Patch::TRACK_SEQ1, 0.0f,
+          16.9f, KnobRange::RANGE_INT);
+  setKnob(KNOBS_TRACKS, 2, Patch::PARAM_DIVIDER + Patch::TRACK_SEQ1, 1.0f,
+          maxDivider, KnobRange::RANGE_INT);
+  setKnob(KNOBS_TRACKS, 3, Patch::PARAM_DIRECTION + Patch::TRACK_SEQ1, 0.0f,
+          maxDirection, KnobRange::RANGE_INT);
+  setKnob(KNOBS_TRACKS, 4, Patch::PARAM_LENGTH + Patch::TRACK_SEQ2, 1.0f,
+          maxLength, KnobRange::RANGE_INT);
+  setKnob(KNOBS_TRACKS, 5, Patch::PARAM_LENGTH + Patch::TRACK_PITCH, 1.0f,
+          Patch::steps_ + 0.9f, KnobRange::RANGE_INT);
+  setKnob(KNOBS_TRACKS, 6, Patch::PARAM_DIVIDER + Patch::TRACK_PITCH, 1.0f,
+          maxDivider, KnobRange::RANGE_INT);
+  setKnob(KNOBS_TRACKS, 7, Patch::PARAM_DIRECTION + Patch::TRACK_PITCH, 0.0f,
+          maxDirection, KnobRange::RANGE_INT);
+
+  // everything on screen, allocated once, only what changed gets drawn
+  TextScreen<32> screen;
+  TextField &bpmField = screen.Add(0, row1);
+  TextField &cpuField = screen.Add(86, row1);
+  TextField &shift1Field = screen.Add(0, row7);
+  TextField &shift2Field = screen.Add(86, row7);
+  // sequence, 4 steps per row
+  TextField *noteFields[8];
+  for (size_t i = 0; i < 8; i++) {
+    noteFields[i] =
+        &screen.Add((i % 4) * 30 + screenOffset, i < 4 ? row2 : row3);
+  }
+  // parameter names and values, 4 per row
+  const char *paramNames[8] = {"Trns", "????", "????", "????",
+                               "EnvD", "Freq", "Q",    "FilD"};
+  TextField *paramFields[8];
+  for (size_t i = 0; i < 8; i++) {
+    uint8_t xPos = (i % 4) * 30 + screenOffset;
+    screen.Add(xPos, i < 4 ? row4 : row6).SetText(paramNames[i]);
+    paramFields[i] = &screen.Add(xPos, i < 4 ? row5 : row7);
+  }
+  hw.ClearDisplay();
+
   while (1) {
     // count main loop iterations
     ++mainCount;
 
-    // set bpm from midi
-    if (hw.UsingMidiClock()) {
-      clock.SetFreq(hw.GetMidiClock() / 60.0f);
-    }
-
     /**
      * CONTROLS
      */
@@ -174,13 +221,15 @@ int main(void) {
     shift1 = hw.SwitchPressed(1);
     shift2 = hw.SwitchPressed(2);
 
-    if (shift1 && hw.SwitchRisingEdge(2) && !hw.UsingMidiClock()) {
-      if (play) {
-        play = false; // stop
-      } else {
-        ResetAllSeqs();
-        play = true;
-      }
+    // shift 1 held and shift 2 let go, only if shift 2 wasn't used for
+    // anything else (both shifts is the audio profile and track page)
+    if (hw.SwitchRisingEdge(2)) {
+      shift2Used = false;
+    }
+    if (shift1 && hw.SwitchFallingEdge(2) && !shift2Used &&
+        !hw.UsingMidiClock()) {
+      // stop, or play from the start
+      patch.SetParam(Patch::PARAM_PLAY_TOGGLE, 0.0f);
     }
 
     // keys
@@ -189,13 +238,23 @@ int main(void) {
     if (!shift2 && !shift1) {
       for (size_t i = 0; i < 16; ++i) {
         if (hw.KeyboardRisingEdge(i)) {
+          // the LED follows the preset, see below
           if (hw.GetKeyGroup(i) == 'A') {
-            seq1.ToggleStep(i - 8);
+            patch.SetParam(Patch::PARAM_SEQ1_TOGGLE, hw.GetKeyIndex(i));
           }
           if (hw.GetKeyGroup(i) == 'B') {
-            seq2.ToggleStep(i);
+            patch.SetParam(Patch::PARAM_SEQ2_TOGGLE, hw.GetKeyIndex(i));
           }
-          hw.ToggleKeyLed(i);
+        }
+      }
+    }
+
+    // both shifts, group B picks the audio profile (block size and rate)
+    if (shift1 && shift2) {
+      for (size_t i = 0; i < AudioProfile::PROFILE_LAST; ++i) {
+        if (hw.KeyboardRisingEdge(i)) {
+          shift2Used = true;
+          hw.SetAudioProfile(i, [](float sr) { patch.SetSampleRate(sr); });
         }
       }
     }
@@ -208,76 +267,36 @@ int main(void) {
     // BPM , Mult, Key , Scal, EnvA, FilA, FilS, Comp?
     // Shift 2
     // Pitch
+    // Both shifts
+    // S1Ln, S1Fl, S1Dv, S1Dr, S2Ln, PtLn, PtDv, PtDr
 
     // LFOs in shift 2?
     // Osc mode and filter mode in shift 1?
 
-    // knobs
-    for (size_t i = 0; i < 8; i++) {
-      // do stuff only if the knob was moved
-      if (hw.DidKnobChange(i)) {
-        // shift 1
-        if (shift1 && !shift2) {
-          switch (i) {
-          case 0:
-            // knob 1, bpm (from 20 to 220), only if there's no midi clock
-            if (!hw.UsingMidiClock()) {
-              clock.SetFreq(static_cast<int>(hw.ScaleKnob(i, 20, 220.9)) /
-                            60.f);
-            }
-            break;
-          case 1:
-            // knob 2, bpm mult
-            clock.SetMult(static_cast<int>(hw.ScaleKnob(i, 0, 10.9f)));
-            break;
-          }
-        }
-        // shift 2, change notes
-        if (shift2 && !shift1) {
-          // notes are from 21 to 108, see Quantizer class
-          pitchSeq.SetNote(i, static_cast<int>(hw.ScaleKnob(i, 21, 108)));
-        }
-        // no shift
-        if (!shift1 && !shift2) {
-          switch (i) {
-          case 0:
-            // knob 1, transpose?
-            pitchSeq.SetTranspose(
-                static_cast<int>(hw.ScaleKnob(i, -24.0f, 24.0f)));
-            break;
-          case 1:
-            // knob 2, env1 attack
-            env1.SetAttack(hw.ScaleKnob(i, 0.001f, 5.0f, true));
-            break;
-          case 2:
-            // knob 3, env1 decay
-            env1.SetDecay(hw.ScaleKnob(i, 0.001f, 5.0f, true));
-            break;
-          case 3:
-            // knob 4, filter frequency
-            filter1.SetFreq(hw.ScaleKnob(i, 0.0f, 1.0f));
-            filter2.SetFreq(hw.ScaleKnob(i, 0.0f, 1.0f));
-            break;
-          case 4:
-            // knob 5, filter q
-            filter1.SetQ(hw.ScaleKnob(i, 0.0f, 1.0f));
-            filter2.SetQ(hw.ScaleKnob(i, 0.0f, 1.0f));
-            break;
-          case 5:
-            // knob 6, env2 attack
-            env2.SetAttack(hw.ScaleKnob(i, 0.001f, 5.0f, true));
-            break;
-          case 6:
-            // knob 7, env2 decay
-            env2.SetDecay(hw.ScaleKnob(i, 0.001f, 5.0f, true));
-            break;
-          case 7:
-            // knob 8, env2 scale
-            env2.SetScale(hw.ScaleKnob(i, 0.0f, 1.0f));
-            break;
-          }
-        }
+    // knobs, only the ones that moved
+    KnobEvent knob;
+    while (hw.PopKnobEvent(knob)) {
+      shift2Used |= shift2;
+      uint8_t page = shift1 && shift2
+                         ? KNOBS_TRACKS
+                         : (shift1 ? KNOBS_SHIFT1
+                                   : (shift2 ? KNOBS_SHIFT2 : KNOBS_MAIN));
+      KnobDest &dest = knobDests[page][knob.id];
+      // bpm only if there's no midi clock
+      if (dest.param == Patch::PARAM_LAST ||
+          (dest.param == Patch::PARAM_CLOCK_FREQ && hw.UsingMidiClock())) {
+        continue;
       }
+      // only if the value changed, eg integers
+      if (!dest.range.Set(knob.value)) {
+        continue;
+      }
+      float value = dest.range.Get();
+      if (dest.param == Patch::PARAM_CLOCK_FREQ) {
+        // bpm to hertz
+        value /= 60.f;
+      }
+      patch.SetParam(dest.param, value);
     }
 
     /**
@@ -286,107 +305,100 @@ int main(void) {
 
     // only update screen every x iterations
     if (mainCount % DISPLAY_UPDATE_DELAY == 0) {
-
-      hw.ClearDisplay();
+      // the modules belong to the callback, the screen shows the preset
+      // copy and what the callback published, see Patch::GetStep
+      const Preset &preset = patch.GetPreset();
 
       // print BPM
-      string bpmStr = "BPM:" + to_string(static_cast<int>(clock.GetBpm())) +
-                      clock.GetMultChar();
-      hw.PrintToScreen(bpmStr.c_str(), 0, row1);
+      bpmField.Begin();
+      bpmField.Append("BPM:");
+      bpmField.AppendInt(static_cast<int>(patch.GetBpm()));
+      bpmField.Append(Clock::MultIndexToChar(preset.clockMult));
+      bpmField.End();
       // print CPU usage
-      string cpuStr = "CPU:" + to_string(static_cast<int>(cpuUsage)) + "%";
-      hw.PrintToScreen(cpuStr.c_str(), 86, row1);
-      // print shifts
-      if (shift1) {
-        hw.PrintToScreen("Shift 1", 0, 56);
-      }
-      if (shift2) {
-        hw.PrintToScreen("Shift 2", 86, 56);
+      cpuField.Begin();
+      cpuField.Append("CPU:");
+      cpuField.AppendInt(static_cast<int>(cpuUsage));
+      cpuField.Append("%");
+      cpuField.End();
+      // print shifts, both show the audio profile
+      if (shift1 && shift2) {
+        shift1Field.SetText("Audio");
+        shift2Field.SetText(AudioProfile::Get(hw.GetAudioProfile()).name);
+      } else {
+        shift1Field.SetText(shift1 ? "Shift 1" : "");
+        shift2Field.SetText(shift2 ? "Shift 2" : "");
       }
 
       // print sequence to screen
       for (size_t i = 0; i < 8; i++) {
-        uint8_t xPos = i * 30 + screenOffset; // + offset to center
-        uint8_t yPos = row2;
         // invert color if step is active
-        bool color = !(seq1.IsStepActive(i));
-        // values for second row
-        if (i > 3) {
-          xPos = xPos - (4 * 30);
-          yPos = row3;
-        }
+        bool color = !((preset.seq1 >> i) & 1);
         // if step is playing use [ ]
-        string noteStr = "";
-        (play && seq1.GetCurrentStep() == i) ? noteStr += "[" : noteStr += " ";
-        noteStr += pitchSeq.StepToName(i);
-        (play && seq1.GetCurrentStep() == i) ? noteStr += "]" : noteStr += " ";
-        hw.PrintToScreen(noteStr.c_str(), xPos, yPos, color);
+        bool playing =
+            patch.play && patch.GetStep(Patch::TRACK_SEQ1) == i;
+        noteFields[i]->Begin(color);
+        noteFields[i]->Append(playing ? "[" : " ");
+        noteFields[i]->Append(patch.GetNoteName(i));
+        noteFields[i]->Append(playing ? "]" : " ");
+        noteFields[i]->End();
       }
 
       // TODO add switch
-      
-      // No switches
-      string pos1Text = "Trns";
-      string pos1Val = to_string(pitchSeq.GetTranspose());
-      string pos2Text = "????";
-      string pos2Val = "";
-      string pos3Text = "????";
-      string pos3Val = "";
-      string pos4Text = "????";
-      string pos4Val = "";
-      string pos5Text = "EnvD";
-      FixedCapStr<8> pos5Val("");
-      pos5Val.AppendFloat(env1.GetDecay());
-      string pos6Text = "Freq";
+
+      // No switches, values under the names
+      paramFields[0]->Begin();
+      paramFields[0]->AppendInt(preset.transpose);
+      paramFields[0]->End();
+      paramFields[4]->Begin();
+      paramFields[4]->AppendFloat(preset.env1Decay);
+      paramFields[4]->End();
       // format filter frequency
-      FixedCapStr<8> pos6Val("");
-      float filtFreq = filter1.GetFreq();
+      float filtFreq = Filter::IndexToFreq(preset.filterFreq);
+      paramFields[5]->Begin();
       if (filtFreq < 100.f) {
         // eg 50.0
-        pos6Val.AppendFloat(filter1.GetFreq(), 1);
+        paramFields[5]->AppendFloat(filtFreq, 1);
       } else if (filtFreq < 10000.f) {
         // eg 250 or 5000
-        pos6Val.AppendInt(static_cast<int>(filter1.GetFreq()));
+        paramFields[5]->AppendInt(static_cast<int>(filtFreq));
       } else {
         // eg 12k
-        pos6Val.AppendInt(static_cast<int>(filter1.GetFreq() / 1000));
-        pos6Val.Append("k");
+        paramFields[5]->AppendInt(static_cast<int>(filtFreq / 1000));
+        paramFields[5]->Append("k");
+      }
+      paramFields[5]->End();
+      paramFields[6]->Begin();
+      paramFields[6]->AppendFloat(Filter::IndexToQ(preset.filterQ));
+      paramFields[6]->End();
+      paramFields[7]->Begin();
+      paramFields[7]->AppendFloat(preset.env2Decay);
+      paramFields[7]->End();
+
+      // only send the screen if something was drawn
+      if (screen.Render(hw)) {
+        hw.UpdateDisplay();
       }
-      string pos7Text = "Q";
-      FixedCapStr<8> pos7Val("");
-      pos7Val.AppendFloat(filter1.GetQ());
-      string pos8Text = "FilD";
-      FixedCapStr<8> pos8Val("");
-      pos8Val.AppendFloat(env2.GetDecay());
-
-      hw.PrintToScreen(pos1Text.c_str(), screenOffset, row4);
-      hw.PrintToScreen(pos1Val.c_str(), screenOffset, row5);
-      hw.PrintToScreen(pos2Text.c_str(), screenOffset + 30 * 1, row4);
-      hw.PrintToScreen(pos2Val.c_str(), screenOffset + 30 * 1, row5);
-      hw.PrintToScreen(pos3Text.c_str(), screenOffset + 30 * 2, row4);
-      hw.PrintToScreen(pos3Val.c_str(), screenOffset + 30 * 2, row5);
-      hw.PrintToScreen(pos4Text.c_str(), screenOffset + 30 * 3, row4);
-      hw.PrintToScreen(pos4Val.c_str(), screenOffset + 30 * 3, row5);
-      hw.PrintToScreen(pos5Text.c_str(), screenOffset, row6);
-      hw.PrintFixedCapStrToScreen(pos5Val, screenOffset, row7);
-      hw.PrintToScreen(pos6Text.c_str(), screenOffset + 30 * 1, row6);
-      hw.PrintFixedCapStrToScreen(pos6Val, screenOffset + 30 * 1, row7);
-      hw.PrintToScreen(pos7Text.c_str(), screenOffset + 30 * 2, row6);
-      hw.PrintFixedCapStrToScreen(pos7Val, screenOffset + 30 * 2, row7);
-      hw.PrintToScreen(pos8Text.c_str(), screenOffset + 30 * 3, row6);
-      hw.PrintFixedCapStrToScreen(pos8Val, screenOffset + 30 * 3, row7);
-
-      // FixedCapStr<32> var("");
-      // var.AppendFloat(pitchSeq.GetTranspose());
-      // hw.Field().display.SetCursor(0, 40);
-      // hw.Field().display.WriteString(var, Font_6x8, true);
-
-      hw.UpdateDisplay();
     }
 
+    // sends changed parts of the screen, without waiting for the bus
+    hw.ProcessDisplay();
+
     if (mainCount % LEDS_UPDATE_DELAY == 0) {
-      hw.ProcessLeds(stepTime);
+      hw.ProcessLeds(patch.stepTime);
+    }
+
+    // saves once nothing changed for a while, at most one flash operation
+    // per iteration, last so nothing else waits for it. An erase holds
+    // the loop for about 50 ms, see PresetStore
+    if (patch.GetPresetChanges() != presetChanges) {
+      presetChanges = patch.GetPresetChanges();
+      presets.Save(patch.GetPreset(), System::GetNow());
+      // toggles, fills and rotations
+      hw.SetStepLeds('A', patch.GetPreset().seq1);
+      hw.SetStepLeds('B', patch.GetPreset().seq2);
     }
+    presets.Process(System::GetNow());
 
     System::Delay(MAIN_DELAY);
   }
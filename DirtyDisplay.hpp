@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * 128x64 monochrome framebuffer that only sends what changed
+ * Drawing goes to buffer_, sent_ is what the display shows, Process
+ * compares the two and sends the changed column spans of each page (8 rows
+ * of pixels), one transfer at a time, without waiting for the bus
+ *
+ * Transport needs:
+ *   bool Busy(), true while a transfer is running
+ *   void Send(page, column, data, size), starts writing size bytes at
+ *     page/column, data stays valid until the next Send
+ *
+ * @tparam Transport SPI on hardware, memory on Linux
+ */
+template <typename Transport> class DirtyDisplay {
+public:
+  DirtyDisplay() {}
+  ~DirtyDisplay() {}
+
+  static constexpr uint8_t width_ = 128;
+  static constexpr uint8_t height_ = 64;
+  static constexpr uint8_t pages_ = height_ / 8;
+  // bytes to select page and column before each transfer
+  static constexpr uint8_t commandBytes_ = 3;
+
+  void Init(Transport *transport) {
+    transport_ = transport;
+    memset(buffer_, 0, sizeof(buffer_));
+    // unknown content, so the first frame is sent whole
+    memset(sent_, 0xFF, sizeof(sent_));
+    cursorX_ = cursorY_ = 0;
+    changed_ = true;
+    ready_ = false;
+    ResetStats();
+  }
+
+  /**
+   * DRAWING, only changes the buffer
+   */
+
+  void Fill(bool on) {
+    memset(buffer_, on ? 0xFF : 0x00, sizeof(buffer_));
+    changed_ = true;
+  }
+
+  void DrawPixel(uint8_t x, uint8_t y, bool on) {
+    if (x >= width_ || y >= height_) {
+      return;
+    }
+    uint8_t bit = 1 << (y & 7);
+    if (on) {
+      buffer_[y >> 3][x] |= bit;
+    } else {
+      buffer_[y >> 3][x] &= ~bit;
+    }
+    changed_ = true;
+  }
+
+  void FillRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
+                bool on) {
+    for (uint8_t j = 0; j < height; j++) {
+      for (uint8_t i = 0; i < width; i++) {
+        DrawPixel(x + i, y + j, on);
+      }
+    }
+  }
+
+  void SetCursor(uint8_t x, uint8_t y) {
+    cursorX_ = x;
+    cursorY_ = y;
+  }
+
+  /**
+   * Same layout as libDaisy's FontDef: FontWidth, FontHeight and one
+   * uint16_t per row, leftmost pixel in the top bit, chars from ' ' to '~'
+   *
+   * @param on true = white on black
+   */
+  template <typename Font> void WriteChar(char c, const Font &font, bool on) {
+    if (c < ' ' || c > '~') {
+      return;
+    }
+    const uint16_t *glyph = &font.data[(c - ' ') * font.FontHeight];
+    for (uint8_t row = 0; row < font.FontHeight; row++) {
+      uint16_t bits = glyph[row];
+      for (uint8_t col = 0; col < font.FontWidth; col++) {
+        bool set = (bits << col) & 0x8000;
+        DrawPixel(cursorX_ + col, cursorY_ + row, set ? on : !on);
+      }
+    }
+    cursorX_ += font.FontWidth;
+  }
+
+  template <typename Font>
+  void WriteString(const char *text, const Font &font, bool on) {
+    while (*text) {
+      WriteChar(*text++, font, on);
+    }
+  }
+
+  /**
+   * SENDING
+   */
+
+  // the frame is complete, start sending it
+  void Update() {
+    ready_ = true;
+    Process();
+  }
+
+  /**
+   * Sends changed spans until the transport is busy, call it often,
+   * it returns right away if there's nothing to do
+   *
+   * @return bool true if the display shows the last frame
+   */
+  bool Process() {
+    if (!ready_ || !changed_) {
+      return !changed_;
+    }
+    while (!transport_->Busy()) {
+      if (!sendNextSpan()) {
+        // everything sent
+        changed_ = false;
+        ready_ = false;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // bytes that went over the bus, commands included
+  uint32_t GetBytesSent() const { return bytesSent_; }
+  uint32_t GetTransfers() const { return transfers_; }
+  void ResetStats() { bytesSent_ = transfers_ = 0; }
+
+  // what the display shows, 8 rows per byte, top pixel in the lowest bit
+  const uint8_t *GetSentPage(uint8_t page) const { return sent_[page]; }
+  const uint8_t *GetPage(uint8_t page) const { return buffer_[page]; }
+
+private:
+  Transport *transport_;
+  uint8_t buffer_[pages_][width_];
+  uint8_t sent_[pages_][width_];
+  uint8_t cursorX_, cursorY_;
+  // something was drawn since the display was last in sync
+  bool changed_;
+  // Update was called, don't send frames that are half drawn
+  bool ready_;
+  uint32_t bytesSent_, transfers_;
+
+  // unchanged columns that are cheaper to send than to start a new
+  // transfer, about the size of the command plus setup
+  static constexpr uint8_t maxGap_ = 8;
+
+  // finds the first changed span and starts sending it
+  bool sendNextSpan() {
+    for (uint8_t page = 0; page < pages_; page++) {
+      const uint8_t *draw = buffer_[page];
+      uint8_t *sent = sent_[page];
+      if (memcmp(draw, sent, width_) == 0) {
+        continue;
+      }
+      uint8_t start = 0;
+      while (draw[start] == sent[start]) {
+        start++;
+      }
+      // grow the span until there's a long enough run of equal columns
+      uint8_t end = start + 1;
+      uint8_t gap = 0;
+      for (uint8_t col = end; col < width_ && gap <= maxGap_; col++) {
+        if (draw[col] != sent[col]) {
+          end = col + 1;
+          gap = 0;
+        } else {
+          gap++;
+        }
+      }
+      // copy first, the transport reads from sent_
+      memcpy(&sent[start], &draw[start], end - start);
+      transport_->Send(page, start, &sent[start], end - start);
+      bytesSent_ += commandBytes_ + end - start;
+      transfers_++;
+      return true;
+    }
+    return false;
+  }
+};
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * One piece of text at a fixed position on screen
+ * Text is built in place with Begin/Append.../End, like FixedCapStr but
+ * without copies, and End only marks the field for drawing if the text
+ * or color actually changed
+ */
+class TextField {
+public:
+  TextField() {}
+  ~TextField() {}
+
+  static constexpr uint8_t maxChars_ = 12;
+  // Font_6x8
+  static constexpr uint8_t charWidth_ = 6;
+  static constexpr uint8_t charHeight_ = 8;
+
+  void Init(uint8_t x, uint8_t y) {
+    x_ = x;
+    y_ = y;
+    text_[0] = '\0';
+    next_[0] = '\0';
+    length_ = nextLength_ = drawnLength_ = 0;
+    color_ = nextColor_ = true;
+    dirty_ = false;
+  }
+
+  /**
+   * Starts building new text
+   *
+   * @param color true = white on black
+   */
+  void Begin(bool color = true) {
+    nextLength_ = 0;
+    next_[0] = '\0';
+    nextColor_ = color;
+  }
+
+  void Append(const char *text) {
+    while (*text && nextLength_ < maxChars_) {
+      next_[nextLength_++] = *text++;
+    }
+    next_[nextLength_] = '\0';
+  }
+
+  void AppendChar(char c) {
+    if (nextLength_ < maxChars_) {
+      next_[nextLength_++] = c;
+      next_[nextLength_] = '\0';
+    }
+  }
+
+  void AppendInt(int value) {
+    if (value < 0) {
+      AppendChar('-');
+    }
+    appendUnsigned(value < 0 ? -static_cast<unsigned>(value) : value, 1);
+  }
+
+  // eg AppendFloat(0.5f) = "0.50", same as FixedCapStr
+  void AppendFloat(float value, uint8_t decimals = 2) {
+    if (value < 0.0f) {
+      AppendChar('-');
+      value = -value;
+    }
+    unsigned scale = 1;
+    for (uint8_t i = 0; i < decimals; i++) {
+      scale *= 10;
+    }
+    // rounded, as a fixed point number
+    unsigned fixed = static_cast<unsigned>(value * scale + 0.5f);
+    appendUnsigned(fixed / scale, 1);
+    if (decimals > 0) {
+      AppendChar('.');
+      appendUnsigned(fixed % scale, decimals);
+    }
+  }
+
+  // Finishes building, true if the field has to be drawn again
+  bool End() {
+    if (nextColor_ != color_ || nextLength_ != length_ ||
+        memcmp(next_, text_, length_) != 0) {
+      memcpy(text_, next_, nextLength_ + 1);
+      length_ = nextLength_;
+      color_ = nextColor_;
+      dirty_ = true;
+    }
+    return dirty_;
+  }
+
+  // same as Begin, Append, End
+  bool SetText(const char *text, bool color = true) {
+    Begin(color);
+    Append(text);
+    return End();
+  }
+
+  const char *GetText() const { return text_; }
+  bool GetColor() const { return color_; }
+  uint8_t GetX() const { return x_; }
+  uint8_t GetY() const { return y_; }
+  bool IsDirty() const { return dirty_; }
+  void SetDirty() { dirty_ = true; }
+
+  // what's on screen right now, including the text being replaced
+  uint8_t GetDrawnWidth() const {
+    return (drawnLength_ > length_ ? drawnLength_ : length_) * charWidth_;
+  }
+
+  // the field was drawn, nothing to do until the text changes again
+  void Drawn() {
+    drawnLength_ = length_;
+    dirty_ = false;
+  }
+
+  bool Overlaps(const TextField &other) const {
+    return x_ < other.x_ + other.GetDrawnWidth() &&
+           other.x_ < x_ + GetDrawnWidth() && y_ < other.y_ + charHeight_ &&
+           other.y_ < y_ + charHeight_;
+  }
+
+private:
+  uint8_t x_, y_;
+  char text_[maxChars_ + 1];
+  char next_[maxChars_ + 1];
+  uint8_t length_, nextLength_, drawnLength_;
+  bool color_, nextColor_;
+  bool dirty_;
+
+  // digits of value, padded with zeros to at least minDigits
+  void appendUnsigned(unsigned value, uint8_t minDigits) {
+    char digits[10];
+    uint8_t count = 0;
+    do {
+      digits[count++] = '0' + value % 10;
+      value /= 10;
+    } while (value > 0 && count < sizeof(digits));
+    while (count < minDigits && count < sizeof(digits)) {
+      digits[count++] = '0';
+    }
+    while (count > 0) {
+      AppendChar(digits[--count]);
+    }
+  }
+};
+
+/**
+ * All the text on screen, allocated once
+ * Only fields that changed are drawn, plus the ones they overlap, in the
+ * order they were added (later fields are drawn on top)
+ *
+ * @tparam Capacity max fields
+ */
+template <size_t Capacity> class TextScreen {
+public:
+  TextScreen() {}
+  ~TextScreen() {}
+
+  /**
+   * Adds a field, keep the reference to update it
+   * There's no check for capacity, it's meant to be set up once at boot
+   */
+  TextField &Add(uint8_t x, uint8_t y) {
+    TextField &field = fields_[count_++];
+    field.Init(x, y);
+    return field;
+  }
+
+  // draw everything again, eg after the screen was cleared
+  void SetAllDirty() {
+    for (size_t i = 0; i < count_; i++) {
+      fields_[i].SetDirty();
+    }
+  }
+
+  /**
+   * Draws changed fields
+   *
+   * @param target anything with ClearRect(x, y, w, h) and
+   * DrawText(x, y, text, color), eg FieldWrap
+   * @return bool true if anything was drawn
+   */
+  template <typename Target> bool Render(Target &target) {
+    // fields under or over a changed one have to be drawn again too
+    bool spread = true;
+    while (spread) {
+      spread = false;
+      for (size_t i = 0; i < count_; i++) {
+        if (!fields_[i].IsDirty()) {
+          continue;
+        }
+        for (size_t j = 0; j < count_; j++) {
+          if (!fields_[j].IsDirty() && fields_[i].Overlaps(fields_[j])) {
+            fields_[j].SetDirty();
+            spread = true;
+          }
+        }
+      }
+    }
+
+    // clear everything first, so clearing doesn't erase a drawn field
+    bool drawn = false;
+    for (size_t i = 0; i < count_; i++) {
+      TextField &field = fields_[i];
+      if (field.IsDirty()) {
+        target.ClearRect(field.GetX(), field.GetY(), field.GetDrawnWidth(),
+                         TextField::charHeight_);
+        drawn = true;
+      }
+    }
+    for (size_t i = 0; i < count_; i++) {
+      TextField &field = fields_[i];
+      if (field.IsDirty()) {
+        target.DrawText(field.GetX(), field.GetY(), field.GetText(),
+                        field.GetColor());
+        field.Drawn();
+      }
+    }
+    return drawn;
+  }
+
+private:
+  size_t count_ = 0;
+  TextField fields_[Capacity];
+};
@@ -1,80 +1,175 @@
 #pragma once
 
 #include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 
+/**
+ * Attack/decay envelope
+ * Every stage is a one pole going to a target past the end of the stage,
+ * so it gets there in time (like an analog envelope with a comparator)
+ * out += (target - out) * k, one multiply-add per sample, k and target
+ * are calculated when times or curve change, no divisions per sample
+ * Linear is the same thing with a target very far away
+ */
 class Envelope {
 public:
   Envelope() {}
   ~Envelope() {}
 
+  enum { STAGE_OFF, STAGE_ATTACK, STAGE_DECAY };
+
   void Init(float sr) {
     sr_ = sr;
-    stageTime_ = 0.0f;
-    stageTimeInc_ = 1.0f / sr_; // samples in one second
-    stage_ = 0;
+    stage_ = STAGE_OFF;
     attack_ = 0.1f; // seconds
     decay_ = 1.0f;  // seconds
     curve_ = 0.0f;
     scale_ = 1.0f;
     out_ = 0.0f;
+    calcAttack();
+    calcDecay();
+  }
+
+  // keeps the stage and level, only the coefficients change
+  void SetSampleRate(float sr) {
+    sr_ = sr;
+    calcAttack();
+    calcDecay();
   }
 
   // 0.001sec to 10sec
   void SetAttack(float attack) {
     attack_ = (attack < 0.001f) ? 0.001f : (attack > 5.0f ? 5.0f : attack);
+    calcAttack();
   }
 
   void SetDecay(float decay) {
     decay_ = (decay < 0.001f) ? 0.001f : (decay > 5.0f ? 5.0f : decay);
+    calcDecay();
   }
 
   void SetScale(float scale) {
     scale_ = (scale < 0.0f) ? 0.0f : (scale > 1.0f ? 1.0f : scale);
   }
 
-  void Trigger() {
-    if (out_ == 0.0f) {
-      stageTime_ = 0.0f;
-    } else {
-      // retriggers, to avoid click
-      // TODO make this an option, filter should not retrigger
-      stageTime_ = out_ * attack_;
+  // 0 = linear, 1 = very exponential
+  void SetCurve(float curve) {
+    curve_ = (curve < 0.0f) ? 0.0f : (curve > 1.0f ? 1.0f : curve);
+    calcAttack();
+    calcDecay();
+  }
+
+  /**
+   * @param late how long ago the trigger really happened, in samples (0 to
+   * 1), eg Clock::Tick::frac, the attack starts that much further in
+   */
+  void Trigger(float late = 0.0f) {
+    // attack starts from the current level, retriggers without clicks
+    // TODO make this an option, filter should not retrigger
+    stage_ = STAGE_ATTACK;
+    late = late < 0.0f ? 0.0f : (late > 1.0f ? 1.0f : late);
+    // part of one step, the curve is a straight line at this scale
+    out_ += (attackTarget_ - out_) * attackK_ * late;
+    if (out_ >= 1.0f) {
+      out_ = 1.0f;
+      stage_ = STAGE_DECAY;
     }
-    stage_ = 1;
   }
 
   float Process() {
-    // attack
-    if (stage_ == 1) {
-      stageTime_ += stageTimeInc_;
-      out_ = stageTime_ / attack_;
-      // TODO apply curve here
-      // end of attack, go to decay
-      if (out_ >= 1.0f) {
-        stageTime_ = 0.0f;
-        stage_ = 2;
-      }
+    if (stage_ == STAGE_ATTACK) {
+      attackStep();
+    } else if (stage_ == STAGE_DECAY) {
+      decayStep();
     }
+    return out_ * scale_;
+  }
 
-    if (stage_ == 2) {
-      stageTime_ += stageTimeInc_;
-      out_ = stageTime_ / decay_;
-      out_ = 1.0f - out_;
-      // TODO apply curve here
-      // end of decay, stop
-      if (out_ <= 0.0001f) {
-        out_ = 0.0f;
-        stage_ = 0;
-      }
+  /**
+   * Renders a block of samples, same result as calling Process on each one
+   * Stages only go forward within a block, so each gets its own loop
+   *
+   * @param out buffer to write to
+   * @param size number of samples
+   */
+  void ProcessBlock(float *out, size_t size) {
+    size_t i = 0;
+    for (; i < size && stage_ == STAGE_ATTACK; i++) {
+      attackStep();
+      out[i] = out_ * scale_;
     }
-    return out_ * scale_;
+    for (; i < size && stage_ == STAGE_DECAY; i++) {
+      decayStep();
+      out[i] = out_ * scale_;
+    }
+    // nothing changes until the next trigger
+    std::fill(out + i, out + size, out_ * scale_);
   }
 
   float GetAttack() { return attack_; }
   float GetDecay() { return decay_; }
+  float GetCurve() { return curve_; }
+  float GetScale() { return scale_; }
 
 private:
-  uint8_t stage; // OFF 0, ATTACK 1, DECAY 2
-  float sr_, stageTime_, stageTimeInc_, stage_, attack_, decay_, curve_, scale_,
-      out_;
+  uint8_t stage_;
+  float sr_, attack_, decay_, curve_, scale_, out_;
+  // out += (target - out) * k, for each stage
+  float attackTarget_, attackK_, decayTarget_, decayK_;
+
+  void attackStep() {
+    out_ += (attackTarget_ - out_) * attackK_;
+    // end of attack, go to decay
+    if (out_ >= 1.0f) {
+      out_ = 1.0f;
+      stage_ = STAGE_DECAY;
+    }
+  }
+
+  void decayStep() {
+    out_ += (decayTarget_ - out_) * decayK_;
+    // end of decay, stop
+    if (out_ <= 0.0001f) {
+      out_ = 0.0f;
+      stage_ = STAGE_OFF;
+    }
+  }
+
+  // how far past the end of the stage the target is, relative to the
+  // stage, big = almost linear, small = very curved
+  float overshoot() {
+    if (curve_ == 0.0f) {
+      // far enough that the curve is linear within float precision
+      return 1000000.0f;
+    }
+    return 0.001f * powf(100000.0f, 1.0f - curve_);
+  }
+
+  void calcAttack() {
+    calcStage(attack_ * sr_, 0.0f, 1.0f, attackTarget_, attackK_);
+  }
+
+  void calcDecay() {
+    calcStage(decay_ * sr_, 1.0f, 0.0f, decayTarget_, decayK_);
+  }
+
+  // target and k for a stage that goes from "from" to "to" in "samples"
+  void calcStage(float samples, float from, float to, float &target,
+                 float &k) {
+    float r = overshoot();
+    // distance to target goes from 1 + r to r (that's "to") in "samples"
+    k = -expm1f(-log1pf(1.0f / r) / samples);
+    // the last step is r * k, if it's under float precision around 1.0
+    // the curve stalls just before the end, so aim a bit further
+    for (uint8_t i = 0; i < 2 && r * k < minStep_; i++) {
+      r = minStep_ / k;
+      k = -expm1f(-log1pf(1.0f / r) / samples);
+    }
+    target = to + (to - from) * r;
+  }
+
+  // a couple of float steps around 1.0
+  static constexpr float minStep_ = 2.4e-7f;
 };
@@ -0,0 +1,21 @@
+#include "FastSine.hpp"
+
+float FastSine::table_[FastSine::tableSize_ + 1];
+std::atomic<uint8_t> FastSine::tableState_(FastSine::TABLE_EMPTY);
+
+void FastSine::InitTable() {
+  if (tableState_.load(std::memory_order_acquire) == TABLE_READY) {
+    return;
+  }
+  // the first caller builds it, anyone else waits until it's done
+  uint8_t state = TABLE_EMPTY;
+  if (!tableState_.compare_exchange_strong(state, TABLE_BUILDING)) {
+    while (tableState_.load(std::memory_order_acquire) != TABLE_READY) {
+    }
+    return;
+  }
+  for (int i = 0; i <= tableSize_; i++) {
+    table_[i] = sinf(TWOPI_F * i / tableSize_);
+  }
+  tableState_.store(TABLE_READY, std::memory_order_release);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "utilities.hpp"
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * Sine generators for Oscillator MODE_SIN, phase goes from 0 to 1
+ * Max errors are absolute, measured against double precision sin()
+ * with host/SineBench.cpp
+ *
+ * TABLE: 512 point table with linear interpolation, max error 1.9e-5
+ * POLY: 7th order minimax polynomial, max error 7.4e-7
+ * RESONATOR: rotates a (sin, cos) pair by the phase increment every sample,
+ * synced to the oscillator phase with POLY every syncInterval_ samples and
+ * on every frequency change, so it can't drift or blow up. Max error 2.5e-6
+ */
+class FastSine {
+public:
+  FastSine() {}
+  ~FastSine() {}
+
+  enum { ENGINE_TABLE, ENGINE_POLY, ENGINE_RESONATOR, ENGINE_LAST };
+
+  void Init() {
+    InitTable();
+    cosInc_ = 1.0f;
+    sinInc_ = 0.0f;
+    syncCount_ = 0;
+  }
+
+  // builds the shared table, only the first call does anything, safe to
+  // call from more than one thread (host batch renders)
+  static void InitTable();
+
+  static float Table(float phase) {
+    float pos = phase * tableSize_;
+    int i = static_cast<int>(pos);
+    float frac = pos - i;
+    // wraps phase 1.0 back to 0
+    i &= tableSize_ - 1;
+    return table_[i] + frac * (table_[i + 1] - table_[i]);
+  }
+
+  static float Poly(float phase) {
+    // sin(2pi * phase) = -sin(2pi * t), t from -0.5 to 0.5
+    float t = phase - 0.5f;
+    // fold to -0.25 to 0.25, sine is symmetric around 0.25
+    float u = 0.25f - fabsf(0.25f - fabsf(t));
+    u = t < 0.0f ? -u : u;
+    float u2 = u * u;
+    // odd polynomial for sin(2pi * u)
+    float p = -70.9935532f;
+    p = p * u2 + 81.3407822f;
+    p = p * u2 - 41.3371429f;
+    p = p * u2 + 6.28316402f;
+    return -(p * u);
+  }
+
+  /**
+   * Resonator, call when the frequency changes
+   *
+   * @param phaseInc phase increment per sample (0 to 1)
+   */
+  void SetPhaseInc(float phaseInc) {
+    // not per sample, so the rotation can be exact, any error here
+    // grows with every sample until the next sync
+    sinInc_ = sinf(TWOPI_F * phaseInc);
+    cosInc_ = cosf(TWOPI_F * phaseInc);
+    // resync on the next sample, the old pair was rotating at the old speed
+    syncCount_ = 0;
+  }
+
+  /**
+   * Resonator, next sample
+   *
+   * @param phase current oscillator phase, used when syncing
+   */
+  float Resonator(float phase) {
+    if (syncCount_ == 0) {
+      sin_ = Poly(phase);
+      cos_ = Poly(cosPhase(phase));
+      syncCount_ = syncInterval_;
+    }
+    syncCount_--;
+
+    float out = sin_;
+    // rotate by the phase increment
+    float s = sin_ * cosInc_ + cos_ * sinInc_;
+    cos_ = cos_ * cosInc_ - sin_ * sinInc_;
+    sin_ = s;
+    return out;
+  }
+
+private:
+  static constexpr int tableSize_ = 512;
+  // + 1 so interpolation doesn't need to wrap
+  static float table_[tableSize_ + 1];
+  // built once, then only read
+  enum { TABLE_EMPTY, TABLE_BUILDING, TABLE_READY };
+  static std::atomic<uint8_t> tableState_;
+
+  // resonator state
+  static constexpr uint8_t syncInterval_ = 32;
+  float sin_, cos_, sinInc_, cosInc_;
+  uint8_t syncCount_;
+
+  // phase of the cosine, a quarter turn ahead
+  static float cosPhase(float phase) {
+    phase += 0.25f;
+    return phase >= 1.0f ? phase - 1.0f : phase;
+  }
+};
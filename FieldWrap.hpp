@@ -1,5 +1,10 @@
 #pragma once
 
+#include "AudioProfile.hpp"
+#include "Controls.hpp"
+#include "DirtyDisplay.hpp"
+#include "MidiClock.hpp"
+#include "OledTransport.hpp"
 #include <daisy_field.h>
 
 using namespace daisy;
@@ -8,21 +13,62 @@ class FieldWrap {
 public:
   FieldWrap() {}
 
-  void Init(AudioHandle::AudioCallback cb) {
+  /**
+   * @param cb audio callback
+   * @param prepare called with the sample rate before the audio starts,
+   * eg to init what the callback uses
+   */
+  template <typename Prepare>
+  void Init(AudioHandle::AudioCallback cb, Prepare prepare) {
     field_.Init();
-    field_.SetAudioBlockSize(32);
-    field_.SetAudioSampleRate(SaiHandle::Config::SampleRate::SAI_48KHZ);
+    callback_ = cb;
+    knobs_.Init(minKnob_, maxKnob_, knobTolerance_, knobSettleMs_);
+    midiClock_.Init(AudioProfile::Get(AudioProfile::defaultProfile_)
+                        .sampleRate);
     field_.StartAdc();
-    field_.StartAudio(cb);
+    startAudio(AudioProfile::defaultProfile_, prepare);
     // zero LEDs
     field_.led_driver.SwapBuffersAndTransmit();
+    // display is powered up by field_.Init, only the transfers are ours
+    oledTransport_.Init();
+    display_.Init(&oledTransport_);
+  }
+
+  /**
+   * AUDIO
+   */
+
+  /**
+   * Stops the audio, changes block size and sample rate and starts it
+   * again, the output is silent for a few milliseconds
+   * Call from the main loop, prepare is called while the callback isn't
+   * running, so what it uses can be changed there
+   *
+   * @param profile AudioProfile::PROFILE_
+   * @param prepare called with the new sample rate, eg
+   * Patch::SetSampleRate
+   */
+  template <typename Prepare>
+  void SetAudioProfile(uint8_t profile, Prepare prepare) {
+    profile = profile < AudioProfile::PROFILE_LAST
+                  ? profile
+                  : AudioProfile::defaultProfile_;
+    if (profile == profile_) {
+      return;
+    }
+    field_.StopAudio();
+    startAudio(profile, prepare);
   }
+  uint8_t GetAudioProfile() { return profile_; }
 
   /**
    * DISPLAY
    */
-  void ClearDisplay() { field_.display.Fill(false); }
-  void UpdateDisplay() { field_.display.Update(); }
+  void ClearDisplay() { display_.Fill(false); }
+  // starts sending what changed, doesn't wait for it
+  void UpdateDisplay() { display_.Update(); }
+  // keeps sending, call it every main loop iteration
+  void ProcessDisplay() { display_.Process(); }
 
   /**
    * Prints a char* to screen
@@ -34,14 +80,23 @@ public:
    */
   void PrintToScreen(const char *text, uint8_t x, uint8_t y,
                      bool color = true) {
-    FixedCapStr<16> str(text);
-    PrintFixedCapStrToScreen(str, x, y);
+    display_.SetCursor(x, y);
+    display_.WriteString(text, Font_6x8, color);
   }
 
-  void PrintFixedCapStrToScreen(FixedCapStr<16> text, uint8_t x, uint8_t y,
-                                bool color = true) {
-    field_.display.SetCursor(x, y);
-    field_.display.WriteString(text, Font_6x8, color);
+  template <size_t Capacity>
+  void PrintFixedCapStrToScreen(const FixedCapStr<Capacity> &text, uint8_t x,
+                                uint8_t y, bool color = true) {
+    PrintToScreen(text, x, y, color);
+  }
+
+  // for TextScreen::Render, see Display.hpp
+  void ClearRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height) {
+    display_.FillRect(x, y, width, height, false);
+  }
+
+  void DrawText(uint8_t x, uint8_t y, const char *text, bool color) {
+    PrintToScreen(text, x, y, color);
   }
 
   /**
@@ -59,6 +114,25 @@ public:
     blinking_ = true;
   }
 
+  // blinks the key of a step, nothing for steps past the keys
+  void BlinkStepLed(char group, uint8_t step) {
+    if (step < keysPerGroup_) {
+      BlinkKeyLed(GetKey(group, step));
+    }
+  }
+
+  // on for the active steps in a group, bit n is step n, blinking keys
+  // keep blinking
+  void SetStepLeds(char group, uint64_t sequence) {
+    for (uint8_t step = 0; step < keysPerGroup_; step++) {
+      uint8_t key = GetKey(group, step);
+      bool on = (sequence >> step) & 1;
+      on = keyLedsBlinking[key] ? !on : on;
+      keysLedsChanged_ |= keyLedsStates_[key] != on;
+      keyLedsStates_[key] = on;
+    }
+  }
+
   /**
    * Processes and applies current status of LEDs
    *
@@ -89,20 +163,12 @@ public:
    * CONTROLS
    */
 
+  // scans every knob, moved ones go in the event queue, see PopKnobEvent
   void ProcessAllControls() {
     field_.ProcessAllControls();
-    // process knobs, check for tolerance
+    uint32_t now = System::GetNow();
     for (size_t i = 0; i < 8; i++) {
-      float tempKnobValue = field_.knob[i].Process();
-      if (tempKnobValue < 0.0f) {
-        tempKnobValue = 0.0f;
-      }
-      if (fabsf(tempKnobValue - knobValues_[i]) > knobTolerance_) {
-        knobValues_[i] = tempKnobValue;
-        knobChanged_[i] = true;
-        return;
-      }
-      knobChanged_[i] = false;
+      knobs_.Scan(i, field_.knob[i].Process(), now);
     }
   }
 
@@ -126,6 +192,15 @@ public:
     return 'B';
   }
 
+  // keys in each group, the steps they show
+  static constexpr uint8_t keysPerGroup_ = 8;
+  // which step a key is in its group, 0 is the leftmost
+  uint8_t GetKeyIndex(uint8_t key) { return key % keysPerGroup_; }
+  // the key of a step, group B is 0 to 7, A is 8 to 15
+  uint8_t GetKey(char group, uint8_t index) {
+    return group == 'A' ? keysPerGroup_ + index : index;
+  }
+
   // switches
 
   bool SwitchRisingEdge(uint8_t i) {
@@ -136,6 +211,14 @@ public:
     }
   }
 
+  bool SwitchFallingEdge(uint8_t i) {
+    if (i == 1) {
+      return field_.GetSwitch(DaisyField::SW_1)->FallingEdge();
+    } else {
+      return field_.GetSwitch(DaisyField::SW_2)->FallingEdge();
+    }
+  }
+
   bool SwitchPressed(uint8_t i) {
     if (i == 1) {
       return field_.GetSwitch(DaisyField::SW_1)->Pressed();
@@ -146,25 +229,19 @@ public:
 
   // knobs
 
-  float ScaleKnob(int i, float minOutput, float maxOutput, bool log = false) {
+  // knobs that moved since the last call, oldest first
+  bool PopKnobEvent(KnobEvent &event) { return knobs_.PopEvent(event); }
 
-    float norm = (knobValues_[i] - minKnob_) / (maxKnob_ - minKnob_);
-    norm = (norm < 0.0f) ? 0.0f : (norm > 1.0f ? 1.0f : norm);
-
-    if (log) {
-      // log scale
-      float logMin = logf(minOutput);
-      float logMax = logf(maxOutput);
-      // the power shapes the curve, 1 = normal log scale
-      return expf(logMin + powf(norm, 0.5) * (logMax - logMin));
-    } else {
-      // linear scale
-      return norm * (maxOutput - minOutput) + minOutput;
-    }
+  // for one off reads, use a KnobRange for parameters
+  float ScaleKnob(int i, float minOutput, float maxOutput, bool log = false) {
+    KnobRange range;
+    range.Init(minOutput, maxOutput,
+               log ? KnobRange::RANGE_LOG : KnobRange::RANGE_LINEAR);
+    return range.Scale(knobs_.GetValue(i));
   }
 
-  bool DidKnobChange(uint8_t i) { return knobChanged_[i]; }
-  float GetKnobValue(uint8_t i) { return knobValues_[i]; }
+  // normalized, 0 to 1
+  float GetKnobValue(uint8_t i) { return knobs_.GetValue(i); }
   float GetKnobValueInHertz(uint8_t i) {
     // notes from 21 to 108 (A0 to C8)
     uint8_t note = static_cast<int>(ScaleKnob(i, 21, 108));
@@ -178,10 +255,13 @@ public:
 
   void InitMidi() { field_.midi.StartReceive(); }
 
-  // calculate time between clock packets
-  // delta = time between packet 0 and 24 (24ppqn)
-  // bpm = 60000 / delta
-  void ProcessMidiClock() {
+  /**
+   * Reads MIDI, clock pulses go to the clock follower, see MidiClock.hpp
+   * Call from the audio callback, pulses are timestamped with the block
+   *
+   * @param time samples, start of the current block
+   */
+  void ProcessMidiClock(uint32_t time) {
     field_.midi.Listen();
     while (field_.midi.HasEvents()) {
       MidiEvent m = field_.midi.PopEvent();
@@ -190,16 +270,13 @@ public:
         if (m.srt_type == TimingClock) {
           // enable midi clock
           usingMidiClock = true;
-          // current time to calculate delta
+          // for the timeout
           lastMidiClockTime = System::GetNow();
-          midiPacketCount++;
-          // calculate delta after 24 packets (24ppqn)
-          if (midiPacketCount >= 24) {
-            uint32_t delta = lastMidiClockTime - prevMs;
-            midiBpm = std::round(60000.0f / delta);
-            prevMs = lastMidiClockTime;
-            midiPacketCount = 0;
-          }
+          midiClock_.Pulse(time);
+        }
+        if (m.srt_type == Start) {
+          // next pulse is the first beat
+          midiClock_.Start();
         }
         if (m.srt_type == Start || m.srt_type == Continue) {
           midiPlaying = true;
@@ -212,12 +289,16 @@ public:
     if (usingMidiClock &&
         (System::GetNow() - lastMidiClockTime > midiTimeoutMs)) {
       usingMidiClock = false;
+      midiClock_.Reset();
     }
   }
 
   bool UsingMidiClock() { return usingMidiClock; }
-  uint16_t GetMidiClock() { return midiBpm; }
+  uint16_t GetMidiClock() { return std::round(midiClock_.GetBpm()); }
   bool MidiIsPlaying() { return midiPlaying; }
+  // period and phase are known, see Patch::SyncClock
+  bool MidiClockLocked() { return midiClock_.IsLocked(); }
+  const MidiClockFollower &GetMidiClockFollower() { return midiClock_; }
 
   // getter for passthrough
   daisy::DaisyField &Field() { return field_; }
@@ -225,6 +306,48 @@ public:
 private:
   DaisyField field_;
 
+  /**
+   * AUDIO
+   */
+
+  AudioHandle::AudioCallback callback_;
+  uint8_t profile_ = AudioProfile::PROFILE_LAST;
+
+  // audio has to be stopped
+  template <typename Prepare>
+  void startAudio(uint8_t profile, Prepare prepare) {
+    const AudioProfile &p = AudioProfile::Get(profile);
+    field_.SetAudioBlockSize(p.blockSize);
+    field_.SetAudioSampleRate(toSaiRate(p.sampleRate));
+    float sr = field_.AudioSampleRate();
+    // pulse timestamps are in samples
+    midiClock_.SetSampleRate(sr);
+    // LEDs blink for the same time with any block size
+    float blocks = blinkingMs_ * 0.001f * sr / p.blockSize;
+    blinkingTime_ = blocks < 1.0f ? 1 : static_cast<uint16_t>(blocks);
+    prepare(sr);
+    profile_ = profile;
+    field_.StartAudio(callback_);
+  }
+
+  static SaiHandle::Config::SampleRate toSaiRate(float sr) {
+    if (sr <= 32000.0f) {
+      return SaiHandle::Config::SampleRate::SAI_32KHZ;
+    }
+    if (sr <= 48000.0f) {
+      return SaiHandle::Config::SampleRate::SAI_48KHZ;
+    }
+    return SaiHandle::Config::SampleRate::SAI_96KHZ;
+  }
+
+  /**
+   * DISPLAY
+   */
+
+  OledTransport oledTransport_;
+  // only changed parts of the screen are sent, see DirtyDisplay.hpp
+  DirtyDisplay<OledTransport> display_;
+
   /**
    * LEDs
    */
@@ -241,8 +364,10 @@ private:
   bool keyLedsBlinking[16];
   // this is so we apply changes only if there were any
   bool keysLedsChanged_ = false;
-  // how long to blink LEDs for, in AudioCallback iterations
-  uint8_t blinkingTime_ = 50;
+  // how long to blink LEDs for, and the same in AudioCallback iterations,
+  // see startAudio
+  static constexpr float blinkingMs_ = 33.0f;
+  uint16_t blinkingTime_ = 50;
   bool blinking_ = false;
 
   /**
@@ -257,8 +382,9 @@ private:
   const float knobTolerance_ = 0.001f;
   const float minKnob_ = 0.000396f;
   const float maxKnob_ = 0.968734f;
-  float knobValues_[8];
-  bool knobChanged_[8];
+  // knob readings glide up from 0 at boot, see KnobScanner::Init
+  const uint32_t knobSettleMs_ = 200;
+  KnobScanner<8> knobs_;
 
   /**
    * MIDI
@@ -266,14 +392,11 @@ private:
 
   // for midi clock in
   bool usingMidiClock = false;
-  uint16_t midiBpm = 0;
   bool midiPlaying = false;
   // when the last clock message was received
   uint32_t lastMidiClockTime = 0;
   // timeout to go back to internal clock
   uint32_t midiTimeoutMs = 500;
-  // for calculating time between packets
-  uint32_t prevMs = 0;
-  // for packet cound (24ppqn)
-  uint16_t midiPacketCount = 0;
+  // tempo and phase from the clock pulses
+  MidiClockFollower midiClock_;
 };
\ No newline at end of file
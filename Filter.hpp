@@ -1,53 +1,53 @@
 #pragma once
 
-#include "utilities.hpp"
-
-class Filter {
+#include "FilterTable.hpp"
+#include "MultiFilter.hpp"
+
+/**
+ * One lowpass, a MultiFilter<1> with the single channel calls (a sample
+ * or a buffer instead of one buffer per channel). Everything else,
+ * ramping, cores and rates, is MultiFilter's. The table, ranges and enums
+ * come from FilterTable, eg Filter::COEFF_RAMP
+ */
+class Filter : public FilterTable {
 public:
   Filter() {}
   ~Filter() {}
 
   // Call before using
-  void Init(float sr);
+  void Init(float sr, uint8_t core = CORE_BIQUAD) { filter_.Init(sr, core); }
+  // keeps state and settings, only moves the table lookups, see RateOffset
+  void SetSampleRate(float sr) { filter_.SetSampleRate(sr); }
   // Get next sample
-  float Process(float in);
+  float Process(float in) {
+    ProcessBlock(&in, 1);
+    return in;
+  }
+  // Filter a block in place, AddFreq stays the same for the whole block
+  void ProcessBlock(float *buf, size_t size) {
+    float *bufs[1] = {buf};
+    filter_.ProcessBlock(bufs, size);
+  }
+  // Filter a block in place, with a value to add to frequency for each sample
+  void ProcessBlock(float *buf, const float *addFreq, size_t size) {
+    float *bufs[1] = {buf};
+    filter_.ProcessBlock(bufs, addFreq, size);
+  }
 
   // Set frequency index (0 to 1)
-  void SetFreq(float freq);
+  void SetFreq(float freq) { filter_.SetFreq(freq); }
   // Set Q index (0 to 1)
-  void SetQ(float q);
+  void SetQ(float q) { filter_.SetQ(q); }
   // Value to add to frequency (0 to 1), eg for envelope
-  void AddFreq(float freq);
+  void AddFreq(float freq) { filter_.AddFreq(freq); }
+  // COEFF_NEAREST or COEFF_RAMP
+  void SetCoeffMode(uint8_t mode) { filter_.SetCoeffMode(mode); }
+  // CORE_BIQUAD or CORE_SVF, see MultiFilter::SetCore
+  void SetCore(uint8_t core) { filter_.SetCore(core); }
 
-  float GetFreq();
-  float GetQ();
+  float GetFreq() { return filter_.GetFreq(); }
+  float GetQ() { return filter_.GetQ(); }
 
 private:
-  const float minFreq_ = 20.0f;
-  const float maxFreq_ = 20000.0f;
-  const float minQ_ = 0.2f;
-  const float maxQ_ = 5.0f;
-  float sr_, freqIndex_, addFreqIndex_, qIndex_, out_;
-
-  float x[3]{};
-  float y[3]{};
-
-  float b0, ib0;
-  float w0, cosw0, alpha;
-
-  // filter coefficients lookup table
-  // lookup table size
-  static constexpr int coeffFreqSteps_ = 512;
-  static constexpr int coeffQSteps_ = 32;
-  // table struct
-  struct FilterCoeffs {
-    float a0, a1, a2;
-    float b1, b2;
-  };
-  // table
-  static FilterCoeffs coeffTable_[coeffQSteps_][coeffFreqSteps_];
-  // generate lookup table
-  void InitLookupTable();
-  // get coefficients from index
-  FilterCoeffs GetNearestCoeffs(float freqIndex, float qIndex);
+  MultiFilter<1> filter_;
 };
@@ -0,0 +1,95 @@
+#include "FilterTable.hpp"
+
+// I don't even know where to start commenting this, watch this:
+// https://www.youtube.com/playlist?list=PLbqhA-NKGP6Afr_KbPUuy_yIBpPR4jzWo
+
+FilterTable::TableCoeffs
+    FilterTable::coeffTable_[FilterTable::coeffQSteps_]
+                            [FilterTable::coeffFreqSteps_];
+std::atomic<bool> FilterTable::coeffTableReady_(false);
+std::atomic_flag FilterTable::coeffTableLock_ = ATOMIC_FLAG_INIT;
+
+float FilterTable::IndexToFreq(float freqIndex) {
+  float freq = minFreq_ * powf(maxFreq_ / minFreq_, freqIndex);
+  return freq;
+}
+float FilterTable::IndexToQ(float qIndex) {
+  return minQ_ + (maxQ_ - minQ_) * qIndex;
+}
+
+void FilterTable::InitLookupTable() {
+  // all filters share the table, every filter after the first one
+  // skips this
+  if (coeffTableReady_.load(std::memory_order_acquire)) {
+    return;
+  }
+  // one builder at a time, the others wait and find it done
+  while (coeffTableLock_.test_and_set(std::memory_order_acquire)) {
+  }
+  if (coeffTableReady_.load(std::memory_order_relaxed)) {
+    coeffTableLock_.clear(std::memory_order_release);
+    return;
+  }
+
+  for (int qIndex = 0; qIndex < coeffQSteps_; ++qIndex) {
+    float q = minQ_ + (maxQ_ - minQ_) * (float(qIndex) / (coeffQSteps_ - 1));
+
+    for (int freqIndex = 0; freqIndex < coeffFreqSteps_; ++freqIndex) {
+      float fT = float(freqIndex) / (coeffFreqSteps_ - 1);
+      float freq = minFreq_ * powf(maxFreq_ / minFreq_, fT);
+
+      float w0 = 2.0f * PI_F * (freq / tableSr_);
+      float cosw0 = cos(w0);
+      float alpha = sin(w0) / (2.0f * q);
+
+      float b0 = 1.0f + alpha;
+      float ib0 = 1.0f / b0;
+
+      // a1 = (1 - cosw0) * ib0 and a2 = a0, see TableCoeffs
+      coeffTable_[qIndex][freqIndex].a0 = ((1.0f - cosw0) / 2.0f) * ib0;
+
+      coeffTable_[qIndex][freqIndex].b1 = (-2.0f * cosw0) * ib0;
+      coeffTable_[qIndex][freqIndex].b2 = (1.0f - alpha) * ib0;
+    }
+  }
+  coeffTableReady_.store(true, std::memory_order_release);
+  coeffTableLock_.clear(std::memory_order_release);
+}
+
+FilterTable::FilterCoeffs FilterTable::GetNearestCoeffs(float freq, float q) {
+  // clamp is necessary because envelope makes freq go above 1
+  freq = (freq < 0) ? 0 : (freq > 1.0f ? 1.0f : freq);
+  // scale to index
+  // could interpolate here but I don't think it's necessary
+  int fi = static_cast<int>(freq * (coeffFreqSteps_ - 1));
+  int qi = static_cast<int>(q * (coeffQSteps_ - 1));
+  return coeffTable_[qi][fi].Expand();
+}
+
+FilterTable::FilterCoeffs FilterTable::GetInterpolatedCoeffs(float freq,
+                                                           float q) {
+  freq = (freq < 0) ? 0 : (freq > 1.0f ? 1.0f : freq);
+  q = (q < 0) ? 0 : (q > 1.0f ? 1.0f : q);
+  float fPos = freq * (coeffFreqSteps_ - 1);
+  float qPos = q * (coeffQSteps_ - 1);
+  // the last entry has nothing after it, interpolate from the one before
+  int fi = static_cast<int>(fPos);
+  fi = fi > coeffFreqSteps_ - 2 ? coeffFreqSteps_ - 2 : fi;
+  int qi = static_cast<int>(qPos);
+  qi = qi > coeffQSteps_ - 2 ? coeffQSteps_ - 2 : qi;
+  float ft = fPos - fi;
+  float qt = qPos - qi;
+
+  auto lerp = [](const TableCoeffs &a, const TableCoeffs &b, float t) {
+    TableCoeffs c;
+    c.a0 = a.a0 + (b.a0 - a.a0) * t;
+    c.b1 = a.b1 + (b.b1 - a.b1) * t;
+    c.b2 = a.b2 + (b.b2 - a.b2) * t;
+    return c;
+  };
+  // bilinear, along frequency first then along q
+  TableCoeffs lowQ = lerp(coeffTable_[qi][fi], coeffTable_[qi][fi + 1], ft);
+  TableCoeffs highQ =
+      lerp(coeffTable_[qi + 1][fi], coeffTable_[qi + 1][fi + 1], ft);
+  return lerp(lowQ, highQ, qt).Expand();
+}
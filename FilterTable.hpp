@@ -0,0 +1,95 @@
+#pragma once
+
+#include "utilities.hpp"
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * What all lowpass filters share: the biquad coefficients table, the
+ * frequency and Q index ranges and the enums. There's no FilterTable
+ * instance, the filters are Filter (one channel) and MultiFilter, both
+ * reach all of this through their own name too, eg Filter::CORE_SVF
+ */
+class FilterTable {
+public:
+  // How coefficients follow frequency changes, see MultiFilter
+  // NEAREST: nearest table entry, looked up on every sample
+  // RAMP: interpolated between table entries, only recalculated when the
+  // frequency changes, blocks ramp linearly to the new coefficients
+  enum { COEFF_NEAREST, COEFF_RAMP, COEFF_LAST };
+
+  // Filter cores, see MultiFilter::SetCore
+  // BIQUAD: RBJ lowpass from the shared table
+  // SVF: zero delay feedback state variable filter, no table, see Svf
+  enum { CORE_BIQUAD, CORE_SVF, CORE_LAST };
+
+  /**
+   * Coefficients lookup table, shared by every MultiFilter
+   * It's only built the first time a filter uses the biquad core, that
+   * saves the boot time for SVF patches, not the memory: the table is
+   * static, its 196 KB (GetTableBytes) are always in RAM
+   */
+
+  // coefficients used by the filter
+  struct FilterCoeffs {
+    float a0, a1, a2;
+    float b1, b2;
+  };
+  // generate lookup table, only if it's not there yet, safe from more than
+  // one thread. It's always made for tableSr_, see RateOffset
+  static void InitLookupTable();
+  /**
+   * The table at another sample rate
+   * A frequency at rate sr has the coefficients of frequency * tableSr_ / sr
+   * at tableSr_, so changing the rate only moves the lookups. Above
+   * tableSr_ the lowest cutoff goes up (40 Hz at 96 kHz), below it the
+   * highest comes down (13 kHz at 32 kHz, Nyquist is 16 kHz anyway)
+   *
+   * @param sr sample rate the filter runs at
+   * @return float add to the frequency index before every lookup
+   */
+  static float RateOffset(float sr) {
+    return -log2f(sr / tableSr_) / IndexToOctaves(1.0f);
+  }
+  // get coefficients from index
+  static FilterCoeffs GetNearestCoeffs(float freqIndex, float qIndex);
+  // get coefficients from index, interpolated between table entries
+  static FilterCoeffs GetInterpolatedCoeffs(float freqIndex, float qIndex);
+  // frequency index (0 to 1) to hertz
+  static float IndexToFreq(float freqIndex);
+  // Q index (0 to 1) to Q
+  static float IndexToQ(float qIndex);
+  // memory used by the shared table
+  static size_t GetTableBytes() { return sizeof(coeffTable_); }
+  // octaves covered by a change in frequency index
+  static float IndexToOctaves(float freqIndex) {
+    return freqIndex * log2f(maxFreq_ / minFreq_);
+  }
+
+private:
+  static constexpr float minFreq_ = 20.0f;
+  static constexpr float maxFreq_ = 20000.0f;
+  static constexpr float minQ_ = 0.2f;
+  static constexpr float maxQ_ = 5.0f;
+
+  // filter coefficients lookup table
+  // lookup table size
+  static constexpr int coeffFreqSteps_ = 512;
+  static constexpr int coeffQSteps_ = 32;
+  // what's stored in the table, for a lowpass a2 == a0 and a1 == 2 * a0
+  struct TableCoeffs {
+    float a0;
+    float b1, b2;
+    FilterCoeffs Expand() const { return {a0, a0 + a0, a0, b1, b2}; }
+  };
+  // table, shared by all filters
+  static TableCoeffs coeffTable_[coeffQSteps_][coeffFreqSteps_];
+  // sample rate of the table, the Field's default
+  static constexpr float tableSr_ = 48000.0f;
+  // true once the table is built
+  static std::atomic<bool> coeffTableReady_;
+  // held while the table is being built
+  static std::atomic_flag coeffTableLock_;
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Halves the sample rate, for oversampled voices
+ * Halfband lowpass (every other tap is 0, the middle one is 0.5) split
+ * into its two polyphase branches, so it runs at the low rate: the odd
+ * inputs only need a delay, the even inputs go through a symmetric FIR
+ * where each coefficient is applied once to a pair of samples. 4 pairs
+ * cost 4 multiplies per output sample for a 15 tap filter
+ *
+ * @tparam MaxPairs most coefficient pairs Init accepts
+ * @tparam MaxBlock most output samples in one ProcessBlock
+ */
+template <size_t MaxPairs, size_t MaxBlock> class HalfbandDecimator {
+public:
+  HalfbandDecimator() {}
+  ~HalfbandDecimator() {}
+
+  /**
+   * Designs the filter, Kaiser windowed sinc
+   * Filter length is 4 * pairs - 1, the delay is pairs output samples
+   *
+   * @param pairs coefficient pairs, more is steeper and costs more
+   */
+  void Init(size_t pairs) {
+    pairs = pairs < 1 ? 1 : (pairs > MaxPairs ? MaxPairs : pairs);
+    pairs_ = pairs;
+    // most stopband past 28 kHz with the passband flat to 20 kHz (at 2x
+    // 48 kHz), found by search. 8 pairs is -45 dB, 16 pairs -85 dB
+    double beta = 0.55 * pairs - 0.2;
+    beta = beta < 1.0 ? 1.0 : beta;
+    size_t middle = 2 * pairs - 1;
+    for (size_t k = 0; k < pairs; k++) {
+      // even tap 2k, an odd distance from the middle
+      double n = double(2 * k) - middle;
+      double sinc = sin(M_PI * n / 2.0) / (M_PI * n);
+      double x = n / (middle + 1.0);
+      coeffs_[k] = sinc * besselI0(beta * sqrt(1.0 - x * x)) / besselI0(beta);
+    }
+    // DC gain is 1, the delay branch has half of it
+    double sum = 0.0;
+    for (size_t k = 0; k < pairs; k++) {
+      sum += 2.0 * coeffs_[k];
+    }
+    for (size_t k = 0; k < pairs; k++) {
+      coeffs_[k] *= 0.5 / sum;
+    }
+    Reset();
+  }
+
+  // clears the history, eg after a quality change
+  void Reset() {
+    for (size_t i = 0; i < evenHistory_; i++) {
+      even_[i] = 0.0f;
+    }
+    for (size_t i = 0; i < oddHistory_; i++) {
+      odd_[i] = 0.0f;
+    }
+  }
+
+  /**
+   * @param in 2 * size samples at the high rate
+   * @param out size samples at the low rate
+   * @param size output samples, up to MaxBlock
+   */
+  void ProcessBlock(const float *in, float *out, size_t size) {
+    // split into the two branches, after the history
+    float *even = even_ + evenHistory_;
+    float *odd = odd_ + oddHistory_;
+    for (size_t i = 0; i < size; i++) {
+      even[i] = in[2 * i];
+      odd[i] = in[2 * i + 1];
+    }
+
+    // delay branch
+    const float *delayed = odd - pairs_;
+    for (size_t i = 0; i < size; i++) {
+      out[i] = 0.5f * delayed[i];
+    }
+    // FIR branch, one coefficient at a time over the whole block so the
+    // inner loop reads forward and vectorizes. Pair k is the k-th newest
+    // and the k-th oldest even sample
+    const size_t span = 2 * pairs_ - 1;
+    for (size_t k = 0; k < pairs_; k++) {
+      const float c = coeffs_[k];
+      const float *newer = even - k;
+      const float *older = even - span + k;
+      for (size_t i = 0; i < size; i++) {
+        out[i] += c * (newer[i] + older[i]);
+      }
+    }
+
+    // keep the end of the block for the next one
+    for (size_t i = 0; i < evenHistory_; i++) {
+      even_[i] = even_[size + i];
+    }
+    for (size_t i = 0; i < oddHistory_; i++) {
+      odd_[i] = odd_[size + i];
+    }
+  }
+
+  size_t GetPairs() const { return pairs_; }
+
+private:
+  size_t pairs_;
+  float coeffs_[MaxPairs];
+  // history is sized for MaxPairs, so Init never moves it
+  static constexpr size_t evenHistory_ = 2 * MaxPairs - 1;
+  static constexpr size_t oddHistory_ = MaxPairs;
+  float even_[evenHistory_ + MaxBlock];
+  float odd_[oddHistory_ + MaxBlock];
+
+  // modified Bessel function of the first kind, for the Kaiser window
+  static double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++) {
+      term *= (x / (2.0 * k)) * (x / (2.0 * k));
+      sum += term;
+    }
+    return sum;
+  }
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+/**
+ * Follows MIDI clock (24 pulses per quarter note) with a delay locked loop
+ * Every pulse is timestamped in samples, the loop predicts when the next
+ * one is due and corrects period and phase by a bit of the error, so
+ * jitter is filtered out but tempo changes are followed. Gives the beat
+ * position at any sample, for Clock::Sync
+ *
+ * See "Using a DLL to filter time", F. Adriaensen
+ */
+class MidiClockFollower {
+public:
+  MidiClockFollower() {}
+  ~MidiClockFollower() {}
+
+  static constexpr uint8_t ppqn_ = 24;
+  // position wraps after 48 beats, a whole number of ticks for every
+  // Clock multiplier (x16 is 1.5 pulses, /16 is 384)
+  static constexpr uint16_t wrapPulses_ = ppqn_ * 48;
+
+  /**
+   * @param sr sample rate
+   * @param bandwidth Hz, lower filters more jitter but follows tempo
+   * changes slower
+   */
+  void Init(float sr, float bandwidth = 1.0f) {
+    sr_ = sr;
+    bandwidth_ = bandwidth;
+    Reset();
+  }
+
+  // timestamps before and after the change don't mix, so it relocks
+  void SetSampleRate(float sr) {
+    sr_ = sr;
+    Reset();
+  }
+
+  // forget everything, eg the clock stopped coming
+  void Reset() {
+    pulses_ = 0;
+    position_ = 0;
+    base_ = 0;
+    t0_ = t1_ = period_ = 0.0;
+    drift_ = jitter_ = 0.0;
+  }
+
+  // MIDI Start, the next pulse is the first beat, also in the middle of
+  // locking
+  void Start() {
+    // the last pulse, or while locking the first one, see position_
+    position_ = IsLocked() ? wrapPulses_ - 1
+                           : (wrapPulses_ - pulses_) % wrapPulses_;
+  }
+
+  /**
+   * A clock pulse arrived
+   *
+   * @param time samples, from a free running counter
+   */
+  void Pulse(uint32_t time) {
+    if (pulses_ == 0) {
+      base_ = time;
+      t0_ = 0.0;
+      pulses_++;
+      return;
+    }
+    double t = static_cast<int32_t>(time - base_);
+    if (pulses_ < lockPulses_) {
+      if (t <= 0.0) {
+        // same timestamp, wait for the next one
+        return;
+      }
+      // first period is the average since the first pulse
+      period_ = t / pulses_;
+      pulses_++;
+      if (pulses_ == lockPulses_) {
+        // t0_ moves from the first pulse to this one, the loop starts
+        position_ = (position_ + lockPulses_ - 2) % wrapPulses_;
+        advance(t, t + period_);
+      }
+      return;
+    }
+
+    // every pulse is one pulse, even a very late one. Jitter can't be told
+    // apart from lost pulses, and MIDI doesn't lose single bytes in practice
+    double error = t - t1_;
+    // one very late pulse can't pull the loop too far
+    double limit = period_ * 0.25;
+    error = (error < -limit) ? -limit : (error > limit ? limit : error);
+
+    // bandwidth relative to how often the loop runs
+    double omega = 2.0 * M_PI * bandwidth_ * period_ / sr_;
+    advance(t1_, t1_ + sqrt(2.0) * omega * error + period_);
+    period_ += omega * omega * error;
+
+    // stats, error is how far the pulse was from the prediction
+    drift_ += statsCoeff_ * (error - drift_);
+    jitter_ += statsCoeff_ * (error * error - jitter_);
+  }
+
+  // enough pulses for a period and phase
+  bool IsLocked() const { return pulses_ >= lockPulses_; }
+
+  /**
+   * @param time samples, same counter as Pulse
+   * @return float beats (quarter notes) since Start, wraps at 48
+   */
+  float GetBeats(uint32_t time) const {
+    if (!IsLocked()) {
+      return 0.0f;
+    }
+    double pulses =
+        position_ + (static_cast<int32_t>(time - base_) - t0_) / (t1_ - t0_);
+    pulses = fmod(pulses, wrapPulses_);
+    pulses = pulses < 0.0 ? pulses + wrapPulses_ : pulses;
+    return pulses / ppqn_;
+  }
+
+  float GetBeatsPerSample() const {
+    return IsLocked() ? 1.0 / (ppqn_ * period_) : 0.0f;
+  }
+
+  float GetBpm() const { return GetBeatsPerSample() * sr_ * 60.0f; }
+
+  // average pulse error against the prediction, ms, positive = late
+  float GetDrift() const { return drift_ * 1000.0 / sr_; }
+  // rms pulse error against the prediction, ms
+  float GetJitter() const { return sqrt(jitter_) * 1000.0 / sr_; }
+
+private:
+  float sr_, bandwidth_;
+  // counts up to lockPulses_, then stays
+  uint16_t pulses_;
+  // half a beat to measure the first period, then the loop runs
+  static constexpr uint16_t lockPulses_ = 12;
+  // pulse number of t0_, since Start. While locking t0_ is the first
+  // pulse, pulses_ - 1 before the last one
+  uint16_t position_;
+  // times are relative to base_ so doubles stay small
+  uint32_t base_;
+  // last and next pulse as predicted, samples per pulse
+  double t0_, t1_, period_;
+  // running averages, about the last 100 pulses
+  double drift_, jitter_;
+  static constexpr double statsCoeff_ = 0.01;
+
+  // next pulse, t0 is the one that just came, t1 the next one due
+  void advance(double t0, double t1) {
+    position_ = (position_ + 1) % wrapPulses_;
+    // move base_ forward, whole samples only
+    int32_t shift = static_cast<int32_t>(t0);
+    base_ += shift;
+    t0_ = t0 - shift;
+    t1_ = t1 - shift;
+  }
+};
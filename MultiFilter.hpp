@@ -0,0 +1,352 @@
+#pragma once
+
+#include "FilterTable.hpp"
+#include "Svf.hpp"
+
+/**
+ * Linked filters, same lowpass on several channels
+ * Frequency, Q and AddFreq are shared, so coefficients are fetched once
+ * for all channels. State is stored per channel in separate arrays, so
+ * the channel loop is plain float math the compiler can vectorize
+ * (4 or 8 channels fill a SIMD register)
+ * Runs either the table biquad or the SVF core, see SetCore
+ */
+template <size_t Channels> class MultiFilter {
+public:
+  MultiFilter() {}
+  ~MultiFilter() {}
+
+  /**
+   * @param sr sample rate
+   * @param core FilterTable::CORE_BIQUAD or FilterTable::CORE_SVF, the
+   * shared table is only built for the biquad
+   */
+  void Init(float sr, uint8_t core = FilterTable::CORE_BIQUAD) {
+    freqIndex_ = 0.5f;
+    addFreqIndex_ = 0.0f;
+    qIndex_ = 0.2f;
+    factor_ = 1;
+    coeffMode_ = FilterTable::COEFF_NEAREST;
+    for (size_t ch = 0; ch < Channels; ch++) {
+      x1_[ch] = x2_[ch] = 0.0f;
+      y1_[ch] = y2_[ch] = 0.0f;
+      ic1_[ch] = ic2_[ch] = 0.0f;
+    }
+    svfOctaves_ = FilterTable::IndexToOctaves(1.0f);
+    SetSampleRate(sr);
+    // SetCore does the rest for the biquad
+    core_ = FilterTable::CORE_SVF;
+    SetCore(core);
+  }
+
+  /**
+   * Filters a block in place on every channel
+   *
+   * @param bufs one buffer per channel
+   * @param addFreq value to add to frequency for each sample, see AddFreq
+   * @param size number of samples
+   */
+  void ProcessBlock(float *const *bufs, const float *addFreq, size_t size) {
+    if (size == 0) {
+      return;
+    }
+    // same state as calling AddFreq on every sample
+    addFreqIndex_ = addFreq[size - 1];
+
+    if (core_ == FilterTable::CORE_SVF) {
+      processSvf(bufs, addFreq, nullptr, nullptr, size);
+      return;
+    }
+    if (coeffMode_ == FilterTable::COEFF_RAMP) {
+      processRamp(bufs, size);
+      return;
+    }
+
+    float x1[Channels], x2[Channels], y1[Channels], y2[Channels];
+    loadState(x1, x2, y1, y2);
+    for (size_t i = 0; i < size; i++) {
+      // one lookup for all channels
+      FilterTable::FilterCoeffs c = FilterTable::GetNearestCoeffs(
+          freqIndex_ + addFreq[i] + rateOffset_, qIndex_);
+      tick(c, bufs, i, x1, x2, y1, y2);
+    }
+    storeState(x1, x2, y1, y2);
+  }
+
+  /**
+   * Filters a block in place on every channel, AddFreq stays the same
+   *
+   * @param bufs one buffer per channel
+   * @param size number of samples
+   */
+  void ProcessBlock(float *const *bufs, size_t size) {
+    if (core_ == FilterTable::CORE_SVF) {
+      processSvf(bufs, nullptr, nullptr, nullptr, size);
+      return;
+    }
+    if (coeffMode_ == FilterTable::COEFF_RAMP) {
+      processRamp(bufs, size);
+      return;
+    }
+
+    FilterTable::FilterCoeffs c = FilterTable::GetNearestCoeffs(
+        freqIndex_ + addFreqIndex_ + rateOffset_, qIndex_);
+    float x1[Channels], x2[Channels], y1[Channels], y2[Channels];
+    loadState(x1, x2, y1, y2);
+    for (size_t i = 0; i < size; i++) {
+      tick(c, bufs, i, x1, x2, y1, y2);
+    }
+    storeState(x1, x2, y1, y2);
+  }
+
+  /**
+   * SVF core only, all three outputs from one pass, the cutoff follows
+   * addFreq on every sample (coefficient mode doesn't matter)
+   *
+   * @param bufs one buffer per channel, filtered in place, lowpass
+   * @param addFreq value to add to frequency for each sample, or nullptr
+   * @param band bandpass, one buffer per channel, or nullptr
+   * @param high highpass, one buffer per channel, or nullptr
+   * @param size number of samples
+   */
+  void ProcessBlock(float *const *bufs, const float *addFreq,
+                    float *const *band, float *const *high, size_t size) {
+    if (size == 0) {
+      return;
+    }
+    if (addFreq) {
+      addFreqIndex_ = addFreq[size - 1];
+    }
+    processSvf(bufs, addFreq, band, high, size);
+  }
+
+  /**
+   * @param core FilterTable::CORE_BIQUAD or FilterTable::CORE_SVF
+   * The first switch to the biquad builds the shared table if it isn't
+   * there, that takes a while, do it from Init or outside the callback
+   */
+  void SetCore(uint8_t core) {
+    core = core < FilterTable::CORE_LAST ? core : FilterTable::CORE_BIQUAD;
+    if (core == core_) {
+      return;
+    }
+    if (core == FilterTable::CORE_BIQUAD) {
+      FilterTable::InitLookupTable();
+      // the biquad state is stale
+      for (size_t ch = 0; ch < Channels; ch++) {
+        x1_[ch] = x2_[ch] = 0.0f;
+        y1_[ch] = y2_[ch] = 0.0f;
+      }
+      // coefficients too, RAMP starts from here
+      coeffsFreq_ = freqIndex_ + addFreqIndex_ + rateOffset_;
+      coeffsQ_ = qIndex_;
+      coeffs_ = FilterTable::GetInterpolatedCoeffs(coeffsFreq_, coeffsQ_);
+    } else {
+      for (size_t ch = 0; ch < Channels; ch++) {
+        ic1_[ch] = ic2_[ch] = 0.0f;
+      }
+    }
+    core_ = core;
+  }
+  uint8_t GetCore() { return core_; }
+
+  // Set frequency index (0 to 1)
+  void SetFreq(float freqIndex) {
+    freqIndex_ = (freqIndex < 0) ? 0 : (freqIndex > 1.0f ? 1.0f : freqIndex);
+  }
+  // Set Q index (0 to 1)
+  void SetQ(float qIndex) {
+    qIndex_ = (qIndex < 0) ? 0 : (qIndex > 1.0f ? 1.0f : qIndex);
+  }
+  // Value to add to frequency (0 to 1), eg for envelope
+  void AddFreq(float freqIndex) {
+    // not clamping here because it already happens in the lookup
+    addFreqIndex_ = freqIndex;
+  }
+  /**
+   * Keeps state and settings, only the derived constants change, the
+   * table isn't rebuilt, see FilterTable::RateOffset
+   * RAMP glides to the new coefficients over the next block
+   */
+  void SetSampleRate(float sr) {
+    sr_ = sr;
+    updateRate();
+  }
+
+  /**
+   * Runs the filter at a multiple of the sample rate, eg in an
+   * oversampled voice, same as SetSampleRate(sr * factor) but the
+   * sample rate stays where it was
+   * The biquad's lowest cutoff goes up by the same factor (40 Hz at 2x)
+   *
+   * @param factor 1 for the normal rate
+   */
+  void SetOversampling(uint8_t factor) {
+    factor_ = factor < 1 ? 1 : factor;
+    updateRate();
+  }
+
+  // FilterTable::COEFF_NEAREST or FilterTable::COEFF_RAMP
+  void SetCoeffMode(uint8_t mode) {
+    mode = mode < FilterTable::COEFF_LAST ? mode : FilterTable::COEFF_NEAREST;
+    if (mode == FilterTable::COEFF_RAMP &&
+        coeffMode_ != FilterTable::COEFF_RAMP &&
+        core_ == FilterTable::CORE_BIQUAD) {
+      // start from the current frequency, not from a stale one
+      coeffsFreq_ = freqIndex_ + addFreqIndex_ + rateOffset_;
+      coeffsQ_ = qIndex_;
+      coeffs_ = FilterTable::GetInterpolatedCoeffs(coeffsFreq_, coeffsQ_);
+    }
+    coeffMode_ = mode;
+  }
+
+  float GetFreq() { return FilterTable::IndexToFreq(freqIndex_); }
+  float GetQ() { return FilterTable::IndexToQ(qIndex_); }
+  float GetFreqIndex() { return freqIndex_; }
+  float GetQIndex() { return qIndex_; }
+
+private:
+  float sr_, freqIndex_, addFreqIndex_, qIndex_;
+  // added to every lookup, for sr_ * factor_
+  float rateOffset_;
+  uint8_t factor_, coeffMode_, core_;
+
+  // SVF state, one entry per channel
+  float ic1_[Channels], ic2_[Channels];
+  // pi * lowest cutoff / sr, and octaves from lowest to highest
+  float svfScale_, svfOctaves_;
+
+  // everything that depends on the rate the filter runs at
+  void updateRate() {
+    float rate = sr_ * factor_;
+    rateOffset_ = FilterTable::RateOffset(rate);
+    svfScale_ = PI_F * FilterTable::IndexToFreq(0.0f) / rate;
+  }
+
+  // cutoff index to SVF coefficients, same frequency range as the table
+  Svf::Coeffs svfCoeffs(float addFreq, float k) {
+    float freq = freqIndex_ + addFreq;
+    freq = (freq < 0) ? 0 : (freq > 1.0f ? 1.0f : freq);
+    float x = svfScale_ * Svf::Exp2(freq * svfOctaves_);
+    // tan blows up at Nyquist, eg 20 kHz at 32 kHz
+    const float maxX = 0.49f * PI_F;
+    return Svf::Make(x > maxX ? maxX : x, k);
+  }
+
+  void processSvf(float *const *bufs, const float *addFreq,
+                  float *const *band, float *const *high, size_t size) {
+    float k = 1.0f / FilterTable::IndexToQ(qIndex_);
+    Svf::Coeffs c = svfCoeffs(addFreqIndex_, k);
+    float ic1[Channels], ic2[Channels];
+    for (size_t ch = 0; ch < Channels; ch++) {
+      ic1[ch] = ic1_[ch];
+      ic2[ch] = ic2_[ch];
+    }
+    for (size_t i = 0; i < size; i++) {
+      if (addFreq) {
+        // one tan approximation per sample, shared by all channels
+        c = svfCoeffs(addFreq[i], k);
+      }
+      for (size_t ch = 0; ch < Channels; ch++) {
+        float b, h;
+        bufs[ch][i] = Svf::Tick(c, bufs[ch][i], ic1[ch], ic2[ch], b, h);
+        if (band) {
+          band[ch][i] = b;
+        }
+        if (high) {
+          high[ch][i] = h;
+        }
+      }
+    }
+    for (size_t ch = 0; ch < Channels; ch++) {
+      ic1_[ch] = ic1[ch];
+      ic2_[ch] = ic2[ch];
+    }
+  }
+
+  // state, one entry per channel
+  float x1_[Channels], x2_[Channels];
+  float y1_[Channels], y2_[Channels];
+
+  // COEFF_RAMP, current coefficients and the indexes they were made from
+  FilterTable::FilterCoeffs coeffs_;
+  float coeffsFreq_, coeffsQ_;
+
+  // recalculates coeffs_ only if frequency or q changed
+  bool updateCoeffs() {
+    float freq = freqIndex_ + addFreqIndex_ + rateOffset_;
+    if (freq == coeffsFreq_ && qIndex_ == coeffsQ_) {
+      return false;
+    }
+    coeffs_ = FilterTable::GetInterpolatedCoeffs(freq, qIndex_);
+    coeffsFreq_ = freq;
+    coeffsQ_ = qIndex_;
+    return true;
+  }
+
+  void processRamp(float *const *bufs, size_t size) {
+    FilterTable::FilterCoeffs c = coeffs_;
+
+    float x1[Channels], x2[Channels], y1[Channels], y2[Channels];
+    loadState(x1, x2, y1, y2);
+    if (updateCoeffs()) {
+      // linear ramp from the old coefficients, ends on the new ones
+      float inc = 1.0f / size;
+      FilterTable::FilterCoeffs d = {
+          (coeffs_.a0 - c.a0) * inc, (coeffs_.a1 - c.a1) * inc,
+          (coeffs_.a2 - c.a2) * inc, (coeffs_.b1 - c.b1) * inc,
+          (coeffs_.b2 - c.b2) * inc};
+      for (size_t i = 0; i < size; i++) {
+        c.a0 += d.a0;
+        c.a1 += d.a1;
+        c.a2 += d.a2;
+        c.b1 += d.b1;
+        c.b2 += d.b2;
+        tick(c, bufs, i, x1, x2, y1, y2);
+      }
+    } else {
+      for (size_t i = 0; i < size; i++) {
+        tick(c, bufs, i, x1, x2, y1, y2);
+      }
+    }
+    storeState(x1, x2, y1, y2);
+  }
+
+  // one biquad step on all channels
+  static inline void tick(const FilterTable::FilterCoeffs &c,
+                          float *const *bufs, size_t i, float *x1, float *x2,
+                          float *y1, float *y2) {
+    for (size_t ch = 0; ch < Channels; ch++) {
+      float x0 = bufs[ch][i];
+      float y0 = c.a0 * x0;
+      y0 += c.a1 * x1[ch];
+      y0 += c.a2 * x2[ch];
+      y0 -= c.b1 * y1[ch];
+      y0 -= c.b2 * y2[ch];
+      x2[ch] = x1[ch];
+      x1[ch] = x0;
+      y2[ch] = y1[ch];
+      y1[ch] = y0;
+      bufs[ch][i] = y0;
+    }
+  }
+
+  // state goes in locals for the block, so it can stay in registers
+  void loadState(float *x1, float *x2, float *y1, float *y2) {
+    for (size_t ch = 0; ch < Channels; ch++) {
+      x1[ch] = x1_[ch];
+      x2[ch] = x2_[ch];
+      y1[ch] = y1_[ch];
+      y2[ch] = y2_[ch];
+    }
+  }
+  void storeState(const float *x1, const float *x2, const float *y1,
+                  const float *y2) {
+    for (size_t ch = 0; ch < Channels; ch++) {
+      x1_[ch] = x1[ch];
+      x2_[ch] = x2[ch];
+      y1_[ch] = y1[ch];
+      y2_[ch] = y2[ch];
+    }
+  }
+};
@@ -0,0 +1,4 @@
+#include "OledTransport.hpp"
+
+uint8_t DMA_BUFFER_MEM_SECTION
+    OledTransport::dmaBuffer_[OledTransport::maxBytes_];
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <daisy_field.h>
+
+using namespace daisy;
+
+/**
+ * Sends parts of the OLED framebuffer to the SSD1309 over SPI with DMA,
+ * used by DirtyDisplay. Same SPI and pins DaisyField uses for its display,
+ * so run it after DaisyField::Init, which also powers up the display
+ */
+class OledTransport {
+public:
+  OledTransport() {}
+  ~OledTransport() {}
+
+  static constexpr size_t maxBytes_ = 128;
+
+  void Init() {
+    SpiHandle::Config config;
+    config.periph = SpiHandle::Config::Peripheral::SPI_1;
+    config.mode = SpiHandle::Config::Mode::MASTER;
+    config.direction = SpiHandle::Config::Direction::TWO_LINES_TX_ONLY;
+    config.datasize = 8;
+    config.clock_polarity = SpiHandle::Config::ClockPolarity::LOW;
+    config.clock_phase = SpiHandle::Config::ClockPhase::ONE_EDGE;
+    config.nss = SpiHandle::Config::NSS::HARD_OUTPUT;
+    config.baud_prescaler = SpiHandle::Config::BaudPrescaler::PS_8;
+    config.pin_config.sclk = seed::D8;
+    config.pin_config.miso = Pin();
+    config.pin_config.mosi = seed::D10;
+    config.pin_config.nss = seed::D7;
+    spi_.Init(config);
+    dc_.Init(seed::D9, GPIO::Mode::OUTPUT);
+    busy_ = false;
+
+    // page addressing, so every transfer can start at any page/column
+    uint8_t commands[2] = {0x20, 0x02};
+    dc_.Write(false);
+    spi_.BlockingTransmit(commands, sizeof(commands));
+  }
+
+  bool Busy() const { return busy_; }
+
+  /**
+   * Starts a transfer, returns before it's done
+   *
+   * @param page 0 to 7, 8 rows each
+   * @param column 0 to 127
+   * @param data bytes to write, copied
+   * @param size max maxBytes_
+   */
+  void Send(uint8_t page, uint8_t column, const uint8_t *data, size_t size) {
+    size = size > maxBytes_ ? maxBytes_ : size;
+    // the 3 commands are short, not worth a DMA transfer
+    uint8_t commands[3] = {static_cast<uint8_t>(0xB0 | page),
+                           static_cast<uint8_t>(column & 0x0F),
+                           static_cast<uint8_t>(0x10 | (column >> 4))};
+    dc_.Write(false);
+    spi_.BlockingTransmit(commands, sizeof(commands));
+    // DMA can't read from DTCM, where the framebuffer is
+    memcpy(dmaBuffer_, data, size);
+    dc_.Write(true);
+    busy_ = true;
+    spi_.DmaTransmit(dmaBuffer_, size, nullptr, transferDone, this);
+  }
+
+private:
+  SpiHandle spi_;
+  GPIO dc_;
+  std::atomic<bool> busy_{false};
+  // in DMA memory, see OledTransport.cpp
+  static uint8_t dmaBuffer_[maxBytes_];
+
+  // DMA interrupt
+  static void transferDone(void *context, SpiHandle::Result result) {
+    static_cast<OledTransport *>(context)->busy_ = false;
+  }
+};
@@ -1,5 +1,10 @@
 #pragma once
+#include "FastSine.hpp"
+#include "Wavetable.hpp"
 #include "utilities.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 
 class Oscillator {
 public:
@@ -7,7 +12,8 @@ public:
   ~Oscillator() {}
 
   // LAST to make it easier for checks
-  enum { MODE_SIN, MODE_TRI, MODE_SAW, MODE_LAST };
+  // TRI is naive and aliases, WT with Wavetable::WAVE_TRI doesn't
+  enum { MODE_SIN, MODE_TRI, MODE_SAW, MODE_WT, MODE_LAST };
 
   void Init(float sr) {
     sr_ = sr;
@@ -19,19 +25,36 @@ public:
     params_[0] = 0.0f;
     params_[1] = 0.0f;
     params_[2] = 0.0f;
+    sine_.Init();
+    sineEngine_ = FastSine::ENGINE_POLY;
+    wavetable_ = nullptr;
 
     calcPhaseInc();
-    calcSineVars();
   }
 
-  void SetFreq(float f) {
+  /**
+   * @param f hertz
+   * @param late how long ago the change really happened, in samples, eg
+   * Clock::Tick::frac, the phase catches up as if it ran at f since then
+   */
+  void SetFreq(float f, float late = 0.0f) {
+    float oldInc = phaseInc_;
     freq_ = f;
     calcPhaseInc();
-    calcSineVars();
+    if (late > 0.0f) {
+      phase_ += late * (phaseInc_ - oldInc);
+      phase_ -= floorf(phase_);
+    }
   }
 
   void SetAmp(float a) { amp_ = a; }
 
+  // keeps frequency and phase, eg when switching to an oversampled voice
+  void SetSampleRate(float sr) {
+    sr_ = sr;
+    calcPhaseInc();
+  }
+
   void SetParam(uint8_t param, float value) { params_[param] = value; }
 
   void SetMode(uint8_t mode) {
@@ -39,21 +62,56 @@ public:
     mode_ = mode < MODE_LAST ? mode : MODE_SIN;
   }
 
+  /**
+   * Wave for MODE_WT, MODE_WT is silent without one
+   * Tables can be shared by any number of oscillators
+   *
+   * @param wavetable has to stay around while it's in use
+   */
+  void SetWavetable(const Wavetable *wavetable) { wavetable_ = wavetable; }
+
+  // Sine generator for MODE_SIN, see FastSine for the options
+  void SetSineEngine(uint8_t engine) {
+    sineEngine_ =
+        engine < FastSine::ENGINE_LAST ? engine : FastSine::ENGINE_POLY;
+    // phase might have moved since the resonator was last used
+    sine_.SetPhaseInc(phaseInc_);
+  }
+
+  /**
+   * Renders a block of samples at the current amplitude
+   * Mode is checked once per block instead of once per sample
+   *
+   * @param out buffer to write to
+   * @param size number of samples
+   */
+  void ProcessBlock(float *out, size_t size) {
+    renderBlock(out, nullptr, size);
+  }
+
+  /**
+   * Renders a block of samples with per sample amplitude, eg from an envelope
+   * Same result as calling SetAmp and Process on every sample
+   *
+   * @param out buffer to write to
+   * @param amp amplitude for each sample
+   * @param size number of samples
+   */
+  void ProcessBlock(float *out, const float *amp, size_t size) {
+    if (size == 0) {
+      return;
+    }
+    renderBlock(out, amp, size);
+    amp_ = amp[size - 1];
+  }
+
   void Process(float *out1, float *out2) {
     switch (mode_) {
 
     case MODE_SIN:
-      // c++ sinf in not efficient but handles the phase automatically
-      // this is temporary
-      *out1 = sinf(phase_ * TWOPI_F);
+      *out1 = sine(phase_);
       *out2 = *out1;
       break;
-      // more efficient but doesn't handle phase and clicks
-      // *out1 = b1 * y1 - y2;
-      // y2 = y1;
-      // y1 = *out1;
-      // *out2 = *out1;
-      // break;
 
     case MODE_TRI:
       *out1 = (2.0f * phase_) - 1.0f;
@@ -68,6 +126,11 @@ public:
       *out2 = *out1;
       break;
 
+    case MODE_WT:
+      *out1 = wavetable_ ? wavetable_->Process(phase_, wtLevel_, wtFade_) : 0;
+      *out2 = *out1;
+      break;
+
     default:
       *out1 = 0.0f;
       *out2 = 0.0f;
@@ -88,16 +151,118 @@ private:
   float sr_, freq_, amp_, phase_, phaseInc_;
   float params_[3];
 
-  void calcPhaseInc() { phaseInc_ = freq_ * (1.0f / sr_); }
+  void calcPhaseInc() {
+    phaseInc_ = freq_ * (1.0f / sr_);
+    // a sinf and a cosf, only for the engine that uses them, SetSineEngine
+    // catches up when it's picked
+    if (sineEngine_ == FastSine::ENGINE_RESONATOR) {
+      sine_.SetPhaseInc(phaseInc_);
+    }
+    Wavetable::FindLevels(phaseInc_, wtLevel_, wtFade_);
+  }
+
+  // MODE_WT, levels only change with the frequency
+  const Wavetable *wavetable_;
+  uint8_t wtLevel_;
+  float wtFade_;
+
+  FastSine sine_;
+  uint8_t sineEngine_;
+  float sine(float phase) {
+    switch (sineEngine_) {
+    case FastSine::ENGINE_TABLE:
+      return FastSine::Table(phase);
+    case FastSine::ENGINE_RESONATOR:
+      return sine_.Resonator(phase);
+    default:
+      return FastSine::Poly(phase);
+    }
+  }
 
-  float w, y1, y2, b1;
-  void calcSineVars() {
-    // from musicdsp, 9-fast-sine-wave-calculation.html
-    // must use 2pi here, but not in other waves for some reason
-    w = freq_ * (TWOPI_F / sr_);
-    y1 = sin(0.0f - w);
-    y2 = sin(0.0f - 2 * w);
-    b1 = 2.0f * cos(w);
+  // same math as Process, but with the switch outside of the loop
+  void renderBlock(float *out, const float *amp, size_t size) {
+    float phase = phase_;
+    switch (mode_) {
+
+    case MODE_SIN:
+      // engine is checked once per block too
+      switch (sineEngine_) {
+      case FastSine::ENGINE_TABLE:
+        for (size_t i = 0; i < size; i++) {
+          out[i] = FastSine::Table(phase);
+          advancePhase(phase);
+        }
+        break;
+      case FastSine::ENGINE_RESONATOR:
+        for (size_t i = 0; i < size; i++) {
+          out[i] = sine_.Resonator(phase);
+          advancePhase(phase);
+        }
+        break;
+      default:
+        for (size_t i = 0; i < size; i++) {
+          out[i] = FastSine::Poly(phase);
+          advancePhase(phase);
+        }
+        break;
+      }
+      break;
+
+    case MODE_TRI:
+      for (size_t i = 0; i < size; i++) {
+        out[i] = 2.0f * (fabsf((2.0f * phase) - 1.0f) - 0.5f);
+        advancePhase(phase);
+      }
+      break;
+
+    case MODE_SAW:
+      for (size_t i = 0; i < size; i++) {
+        out[i] = (2.0f * phase) - 1.0f;
+        out[i] -= polyBLEP(phase, phaseInc_);
+        advancePhase(phase);
+      }
+      break;
+
+    case MODE_WT:
+      if (!wavetable_) {
+        for (size_t i = 0; i < size; i++) {
+          out[i] = 0.0f;
+          advancePhase(phase);
+        }
+        break;
+      }
+      // same cost for any wave, two lookups and three lerps
+      for (size_t i = 0; i < size; i++) {
+        out[i] = wavetable_->Process(phase, wtLevel_, wtFade_);
+        advancePhase(phase);
+      }
+      break;
+
+    default:
+      for (size_t i = 0; i < size; i++) {
+        out[i] = 0.0f;
+        advancePhase(phase);
+      }
+      break;
+    }
+    phase_ = phase;
+
+    if (amp) {
+      for (size_t i = 0; i < size; i++) {
+        out[i] = out[i] * amp[i];
+      }
+    } else {
+      for (size_t i = 0; i < size; i++) {
+        out[i] = out[i] * amp_;
+      }
+    }
+  }
+
+  void advancePhase(float &phase) {
+    phase += phaseInc_;
+    if (phase > 1.0f) {
+      phase -= 1.0f;
+    }
   }
 
   float t, dt;
@@ -0,0 +1,793 @@
+#pragma once
+
+#include "Clock.hpp"
+#include "ControlRate.hpp"
+#include "Envelope.hpp"
+#include "Filter.hpp"
+#include "HalfbandDecimator.hpp"
+#include "MultiFilter.hpp"
+#include "Oscillator.hpp"
+#include "PitchSequencer.hpp"
+#include "Preset.hpp"
+#include "Smoother.hpp"
+#include "SpscQueue.hpp"
+#include "TriggerSequencer.hpp"
+#include <algorithm>
+#include <atomic>
+
+/**
+ * The Cosmos signal graph, without any hardware
+ * AudioCallback in Cosmos.cpp and the host tools both run this,
+ * so what gets profiled on Linux is what runs on the Field
+ */
+class Patch {
+public:
+  Patch() {}
+  ~Patch() {}
+
+  // max samples rendered by each voice stage
+  static constexpr size_t renderBlockSize_ = 32;
+  // steps on the keys, and notes in the pitch sequencer
+  static constexpr uint8_t steps_ = 8;
+  // samples between modulation updates, see ControlRate
+  static constexpr size_t defaultControlInterval_ = 16;
+
+  // Sequencer tracks, each has its own length, direction and divider
+  // (polymeter), see the per track commands below
+  enum { TRACK_SEQ1, TRACK_SEQ2, TRACK_PITCH, TRACK_LAST };
+
+  // Parameters the main loop changes through SetParam
+  enum {
+    // continuous, only the last value sent before a block is applied
+    PARAM_CLOCK_FREQ, // hertz
+    PARAM_CLOCK_MULT, // index, see Clock
+    PARAM_TRANSPOSE,  // semitones
+    PARAM_ENV1_ATTACK,
+    PARAM_ENV1_DECAY,
+    PARAM_ENV2_ATTACK,
+    PARAM_ENV2_DECAY,
+    PARAM_ENV2_SCALE,
+    PARAM_FILTER_FREQ,
+    PARAM_FILTER_Q,
+    PARAM_NOTE, // + step, one for each step, value is the midi note
+    PARAM_LAST_CONTINUOUS = PARAM_NOTE + steps_,
+    // commands, applied in order
+    PARAM_PLAY = PARAM_LAST_CONTINUOUS, // 1 = play from the start, 0 = stop
+    PARAM_PLAY_TOGGLE,                  // stop, or play from the start
+    PARAM_SEQ1_TOGGLE,                  // value is the step
+    PARAM_SEQ2_TOGGLE,                  // value is the step
+    PARAM_OVERSAMPLE,                   // value is OVERSAMPLE_
+    PARAM_FILTER_CORE,                  // value is Filter::CORE_
+    PARAM_CONTROL_INTERVAL,             // samples, 1 is audio rate
+    // + track, one for each track, see TRACK_
+    PARAM_LENGTH,                                 // steps
+    PARAM_DIRECTION = PARAM_LENGTH + TRACK_LAST,  // StepCounter::DIR_
+    PARAM_DIVIDER = PARAM_DIRECTION + TRACK_LAST, // clock ticks per step
+    PARAM_ROTATE = PARAM_DIVIDER + TRACK_LAST,    // steps, negative is earlier
+    PARAM_FILL = PARAM_ROTATE + TRACK_LAST,       // Euclidean hits, not pitch
+    PARAM_LAST = PARAM_FILL + TRACK_LAST
+  };
+
+  // Voice quality, oscillator and filter run at 2x and are decimated
+  // OFF: normal rate, cheapest, aliases at high notes and cutoffs
+  // FAST: 31 tap decimator, about -45 dB of aliasing from above 28 kHz
+  // BEST: 63 tap decimator, about -85 dB
+  enum { OVERSAMPLE_OFF, OVERSAMPLE_FAST, OVERSAMPLE_BEST, OVERSAMPLE_LAST };
+
+  /**
+   * @param sr sample rate
+   * @param filterCore Filter::CORE_, the biquad table is only built for
+   * the biquad, eg start on the SVF and let LoadPreset pick the core
+   */
+  void Init(float sr, uint8_t filterCore = Filter::CORE_BIQUAD) {
+    sr_ = sr;
+    clock.Init(2, sr);
+    seq1.Init(steps_);
+    seq2.Init(steps_);
+    pitchSeq.Init(steps_);
+    osc.Init(sr);
+    osc.SetMode(Oscillator::MODE_SAW);
+    filter.Init(sr, filterCore);
+    // envelope sweeps are smoother, and cheaper than per sample lookups
+    filter.SetCoeffMode(Filter::COEFF_RAMP);
+    env1.Init(sr);
+    env2.Init(sr);
+    // env2 only moves the cutoff, env1 is amplitude and stays per sample
+    env2Control_.Init(&env2, sr, defaultControlInterval_);
+    play = false;
+    stepTime = 0;
+    clockSynced_ = false;
+    for (std::atomic<uint8_t> &step : publishedSteps_) {
+      step.store(0, std::memory_order_relaxed);
+    }
+    publishedBpm_.store(clock.GetBpm(), std::memory_order_relaxed);
+    initSmoothers(sr);
+    setOversample(OVERSAMPLE_OFF);
+    fillPreset();
+  }
+
+  /**
+   * What would be saved now, kept up to date by SetParam, so the main
+   * loop can read it while the audio runs
+   */
+  const Preset &GetPreset() const { return preset_; }
+  // goes up on every change to the preset, to know when to save
+  uint32_t GetPresetChanges() const { return presetChanges_; }
+
+  /**
+   * Restores a saved preset, straight into the modules (knobs don't glide
+   * there). Not thread safe, call it after Init before the audio starts,
+   * or with the audio stopped
+   */
+  void LoadPreset(const Preset &preset) {
+    seq1.SetSequence(preset.seq1);
+    seq2.SetSequence(preset.seq2);
+    for (uint8_t i = 0; i < steps_; i++) {
+      pitchSeq.SetNote(i, preset.notes[i]);
+    }
+    pitchSeq.SetTranspose(preset.transpose);
+    pitchSeq.SetKey(preset.key);
+    pitchSeq.SetScale(preset.scale);
+    const ParamChange continuous[] = {
+        {PARAM_CLOCK_FREQ, preset.clockFreq},
+        {PARAM_CLOCK_MULT, float(preset.clockMult)},
+        {PARAM_ENV1_ATTACK, preset.env1Attack},
+        {PARAM_ENV1_DECAY, preset.env1Decay},
+        {PARAM_ENV2_ATTACK, preset.env2Attack},
+        {PARAM_ENV2_DECAY, preset.env2Decay},
+        {PARAM_ENV2_SCALE, preset.env2Scale},
+        {PARAM_FILTER_FREQ, preset.filterFreq},
+        {PARAM_FILTER_Q, preset.filterQ}};
+    for (const ParamChange &change : continuous) {
+      // smoothers start where the preset is, not where they were
+      Smoother *smoother = smoothers_.Find(change.param);
+      if (smoother) {
+        smoother->Reset(change.value);
+      }
+      setParam(change.param, change.value);
+    }
+    setOversample(preset.oversample);
+    filter.SetCore(preset.filterCore);
+    env2Control_.SetInterval(preset.controlInterval);
+    for (uint8_t track = 0; track < TRACK_LAST; track++) {
+      setParam(PARAM_LENGTH + track, preset.lengths[track]);
+      setParam(PARAM_DIRECTION + track, preset.directions[track]);
+      setParam(PARAM_DIVIDER + track, preset.dividers[track]);
+    }
+    // clamped by the modules
+    fillPreset();
+  }
+
+  /**
+   * Changes the sample rate without starting over, sequences, settings and
+   * voice state stay, only what's derived from the rate is recalculated
+   * (no tables are rebuilt). Not thread safe, call it while the audio is
+   * stopped, see FieldWrap::SetAudioProfile
+   * Any block size works with any rate, see Process
+   */
+  void SetSampleRate(float sr) {
+    sr_ = sr;
+    clock.SetSampleRate(sr);
+    env1.SetSampleRate(sr);
+    env2Control_.SetSampleRate(sr);
+    filter.SetSampleRate(sr);
+    smoothers_.SetSampleRate(sr);
+    uint8_t factor = oversample_ == OVERSAMPLE_OFF ? 1 : oversampleFactor_;
+    osc.SetSampleRate(sr * factor);
+  }
+  float GetSampleRate() { return sr_; }
+
+  void ResetAllSeqs() {
+    // the next tick plays the first step of every track
+    seq1.Reset();
+    seq2.Reset();
+    pitchSeq.Reset();
+    // set phase to end so that you don't have to wait for the next tick
+    clock.SetPhaseToEnd();
+    stepTime = 0;
+  }
+
+  /**
+   * Locks the clock to an external one (eg MIDI) for the next block, call
+   * from the audio callback before every Process while it's running
+   * See Clock::Sync
+   */
+  void SyncClock(float beats, float beatsPerSample) {
+    syncBeats_ = beats;
+    syncBeatsPerSample_ = beatsPerSample;
+    clockSynced_ = true;
+  }
+
+  /**
+   * Sends a parameter change to the audio callback, call from the main loop
+   * Changes are applied at the start of the next block, so the callback
+   * never sees half of an update and the main loop never waits for it
+   *
+   * @param param PARAM_ from the list above
+   * @param value new value, see the list for units
+   * @return bool false if the queue is full and the change was dropped
+   */
+  bool SetParam(uint8_t param, float value) {
+    if (param == PARAM_FILTER_CORE &&
+        static_cast<uint8_t>(value) == Filter::CORE_BIQUAD) {
+      // the first switch builds the table, here and not in the callback
+      Filter::InitLookupTable();
+    }
+    if (!paramQueue_.Push({param, value})) {
+      return false;
+    }
+    trackPreset(param, value);
+    return true;
+  }
+
+  /**
+   * Renders one audio block
+   *
+   * @param out1 left output
+   * @param out2 right output
+   * @param size number of samples, any size, the voice renders it in
+   * pieces of renderBlockSize_
+   * @return bool true if a step started in this block, see TrackMoved
+   */
+  bool Process(float *out1, float *out2, size_t size) {
+    movedTracks_ = 0;
+    applyParams();
+    smoothers_.Process(size);
+    if (clockSynced_) {
+      // after the smoothers, the external clock wins
+      clock.Sync(syncBeats_, syncBeatsPerSample_, size);
+      // so a knob glides from the external tempo when it stops
+      smoothers_.Find(PARAM_CLOCK_FREQ)->Reset(clock.GetFreq());
+      clockSynced_ = false;
+    }
+
+    // every event in the block is known before anything is rendered,
+    // the voice is rendered in segments between them. More ticks than
+    // maxTicks_ (huge blocks, fast tempos) take more than one pass
+    bool ticked = false;
+    for (size_t done = 0; done < size;) {
+      Clock::Tick ticks[maxTicks_];
+      size_t length = size - done;
+      size_t tickCount =
+          play ? clock.ProcessBlock(length, ticks, maxTicks_, &length) : 0;
+      size_t segStart = done;
+      for (size_t i = 0; i < tickCount; i++) {
+        // render everything before the tick with the old settings
+        renderVoice(out1, out2, segStart, done + ticks[i].offset);
+        segStart = done + ticks[i].offset;
+        startStep(ticks[i].frac);
+      }
+      // render the rest of the pass
+      done += length;
+      renderVoice(out1, out2, segStart, done);
+      ticked |= tickCount > 0;
+    }
+
+    stepTime++;
+
+    // for the main loop, see GetStep and GetBpm
+    publishedSteps_[TRACK_SEQ1].store(seq1.GetCurrentStep(),
+                                      std::memory_order_relaxed);
+    publishedSteps_[TRACK_SEQ2].store(seq2.GetCurrentStep(),
+                                      std::memory_order_relaxed);
+    publishedSteps_[TRACK_PITCH].store(pitchSeq.GetCurrentStep(),
+                                       std::memory_order_relaxed);
+    publishedBpm_.store(clock.GetBpm(), std::memory_order_relaxed);
+
+    return ticked;
+  }
+
+  /**
+   * Main loop side, what the callback was doing at the end of the last
+   * block. Everything else the main loop shows comes from GetPreset, the
+   * modules themselves belong to the callback
+   */
+  uint8_t GetStep(uint8_t track) const {
+    return track < TRACK_LAST
+               ? publishedSteps_[track].load(std::memory_order_relaxed)
+               : 0;
+  }
+  // follows the MIDI clock too, unlike the preset's clockFreq
+  float GetBpm() const {
+    return publishedBpm_.load(std::memory_order_relaxed);
+  }
+  // a step's note as it plays, with transpose, from the preset
+  const char *GetNoteName(uint8_t step) {
+    step = step < steps_ ? step : steps_ - 1;
+    return pitchSeq.NoteToName(preset_.notes[step] + preset_.transpose);
+  }
+
+  // the track moved to a new step in the last Process, eg to blink it
+  bool TrackMoved(uint8_t track) const { return (movedTracks_ >> track) & 1; }
+
+  Clock clock;
+  TriggerSequencer seq1;
+  TriggerSequencer seq2;
+  PitchSequencer<steps_> pitchSeq;
+  Oscillator osc;
+  // the voice is mono, one filter, the right output is a copy
+  MultiFilter<1> filter;
+  Envelope env1;
+  Envelope env2;
+
+  // play/pause, the callback changes it, the main loop can read it
+  std::atomic<bool> play{false};
+  // count step time for blinking LEDs, in blocks
+  uint16_t stepTime = 0;
+
+private:
+  // main loop to audio callback
+  struct ParamChange {
+    uint8_t param;
+    float value;
+  };
+  SpscQueue<ParamChange, 64> paramQueue_;
+  // last value of each continuous parameter, waiting to be applied
+  float pendingParams_[PARAM_LAST_CONTINUOUS];
+  uint32_t pendingMask_ = 0;
+  static_assert(PARAM_LAST_CONTINUOUS <= 32, "pendingMask_ is too small");
+
+  // applies everything the main loop sent since the last block
+  void applyParams() {
+    ParamChange change;
+    while (paramQueue_.Pop(change)) {
+      if (change.param < PARAM_LAST_CONTINUOUS) {
+        // many knob changes, one update
+        pendingParams_[change.param] = change.value;
+        pendingMask_ |= 1u << change.param;
+      } else {
+        applyParam(change.param, change.value);
+      }
+    }
+    for (uint8_t param = 0; pendingMask_ != 0; param++) {
+      if (pendingMask_ & (1u << param)) {
+        applyParam(param, pendingParams_[param]);
+        pendingMask_ &= ~(1u << param);
+      }
+    }
+  }
+
+  void applyParam(uint8_t param, float value) {
+    // continuous controls glide there, see initSmoothers
+    if (smoothers_.SetTarget(param, value)) {
+      return;
+    }
+    setParam(param, value);
+  }
+
+  // applies a change right away
+  void setParam(uint8_t param, float value) {
+    if (param >= PARAM_NOTE && param < PARAM_NOTE + steps_) {
+      pitchSeq.SetNote(param - PARAM_NOTE, static_cast<uint8_t>(value));
+      return;
+    }
+    if (param >= PARAM_LENGTH && param < PARAM_LAST) {
+      // back to the first track's command, and which track
+      uint8_t command = param - (param - PARAM_LENGTH) % TRACK_LAST;
+      uint8_t track = (param - PARAM_LENGTH) % TRACK_LAST;
+      if (track == TRACK_PITCH) {
+        setTrack(pitchSeq, command, value);
+      } else {
+        setTrack(track == TRACK_SEQ1 ? seq1 : seq2, command, value);
+      }
+      return;
+    }
+    switch (param) {
+    case PARAM_CLOCK_FREQ:
+      clock.SetFreq(value);
+      break;
+    case PARAM_CLOCK_MULT:
+      clock.SetMult(static_cast<uint8_t>(value));
+      break;
+    case PARAM_TRANSPOSE:
+      pitchSeq.SetTranspose(static_cast<int8_t>(value));
+      break;
+    case PARAM_ENV1_ATTACK:
+      env1.SetAttack(value);
+      break;
+    case PARAM_ENV1_DECAY:
+      env1.SetDecay(value);
+      break;
+    case PARAM_ENV2_ATTACK:
+      env2.SetAttack(value);
+      break;
+    case PARAM_ENV2_DECAY:
+      env2.SetDecay(value);
+      break;
+    case PARAM_ENV2_SCALE:
+      env2.SetScale(value);
+      break;
+    case PARAM_FILTER_FREQ:
+      filter.SetFreq(value);
+      break;
+    case PARAM_FILTER_Q:
+      filter.SetQ(value);
+      break;
+    case PARAM_PLAY:
+      if (value > 0.5f) {
+        ResetAllSeqs();
+        play = true;
+      } else {
+        play = false;
+      }
+      break;
+    case PARAM_PLAY_TOGGLE:
+      // from what the callback sees, two quick presses toggle twice
+      setParam(PARAM_PLAY, play ? 0.0f : 1.0f);
+      break;
+    case PARAM_SEQ1_TOGGLE:
+      seq1.ToggleStep(static_cast<uint8_t>(value));
+      break;
+    case PARAM_SEQ2_TOGGLE:
+      seq2.ToggleStep(static_cast<uint8_t>(value));
+      break;
+    case PARAM_OVERSAMPLE:
+      setOversample(static_cast<uint8_t>(value));
+      break;
+    case PARAM_FILTER_CORE:
+      filter.SetCore(static_cast<uint8_t>(value));
+      break;
+    case PARAM_CONTROL_INTERVAL:
+      env2Control_.SetInterval(static_cast<size_t>(value));
+      break;
+    }
+  }
+
+  // same commands for both kinds of track, Fill only has bits to set
+  static void setTrack(TriggerSequencer &track, uint8_t command,
+                       float value) {
+    if (command == PARAM_FILL) {
+      track.Fill(static_cast<uint8_t>(value));
+      return;
+    }
+    setTrackCommon(track, command, value);
+  }
+  static void setTrack(PitchSequencer<steps_> &track, uint8_t command,
+                       float value) {
+    setTrackCommon(track, command, value);
+  }
+  template <typename Track>
+  static void setTrackCommon(Track &track, uint8_t command, float value) {
+    switch (command) {
+    case PARAM_LENGTH:
+      track.SetLength(static_cast<uint8_t>(value));
+      break;
+    case PARAM_DIRECTION:
+      track.SetDirection(static_cast<uint8_t>(value));
+      break;
+    case PARAM_DIVIDER:
+      track.SetDivider(static_cast<uint8_t>(value));
+      break;
+    case PARAM_ROTATE:
+      track.Rotate(static_cast<int>(value));
+      break;
+    }
+  }
+
+  // bit n is TRACK_ n, see TrackMoved
+  uint8_t movedTracks_ = 0;
+  // see GetStep and GetBpm
+  std::atomic<uint8_t> publishedSteps_[TRACK_LAST];
+  std::atomic<float> publishedBpm_{0.0f};
+
+  // modulation at control rate, see ControlRate
+  ControlRate<Envelope> env2Control_;
+
+  // main loop side copy of what's saved, see GetPreset
+  Preset preset_;
+  uint32_t presetChanges_ = 0;
+  static_assert(steps_ <= Preset::maxSteps_, "steps don't fit in a preset");
+  static_assert(TRACK_LAST <= Preset::tracks_, "tracks don't fit either");
+
+  // everything from the modules, only when they're not running
+  void fillPreset() {
+    preset_.seq1 = seq1.GetSequence();
+    preset_.seq2 = seq2.GetSequence();
+    for (uint8_t i = 0; i < Preset::maxSteps_; i++) {
+      preset_.notes[i] = pitchSeq.GetNote(i);
+    }
+    preset_.transpose = pitchSeq.GetTranspose();
+    preset_.key = pitchSeq.GetKey();
+    preset_.scale = pitchSeq.GetScale();
+    preset_.clockFreq = clock.GetFreq();
+    preset_.clockMult = clock.GetMultIndex();
+    preset_.env1Attack = env1.GetAttack();
+    preset_.env1Decay = env1.GetDecay();
+    preset_.env2Attack = env2.GetAttack();
+    preset_.env2Decay = env2.GetDecay();
+    preset_.env2Scale = env2.GetScale();
+    preset_.filterFreq = filter.GetFreqIndex();
+    preset_.filterQ = filter.GetQIndex();
+    preset_.oversample = oversample_;
+    preset_.filterCore = filter.GetCore();
+    preset_.controlInterval = env2Control_.GetInterval();
+    fillPresetTrack(TRACK_SEQ1, seq1);
+    fillPresetTrack(TRACK_SEQ2, seq2);
+    fillPresetTrack(TRACK_PITCH, pitchSeq);
+    presetChanges_++;
+  }
+
+  template <typename Track>
+  void fillPresetTrack(uint8_t track, const Track &module) {
+    preset_.lengths[track] = module.GetLength();
+    preset_.directions[track] = module.GetDirection();
+    preset_.dividers[track] = module.GetDivider();
+  }
+
+  // a change the main loop sent, same clamping as the modules
+  void trackPreset(uint8_t param, float value) {
+    auto clamp = [](float x, float min, float max) {
+      return (x < min) ? min : (x > max ? max : x);
+    };
+    uint8_t step = static_cast<uint8_t>(value);
+    if (param >= PARAM_NOTE && param < PARAM_NOTE + steps_) {
+      preset_.notes[param - PARAM_NOTE] = step;
+      presetChanges_++;
+      return;
+    }
+    if (param >= PARAM_LENGTH && param < PARAM_LAST) {
+      trackPresetTrack(param, value);
+      presetChanges_++;
+      return;
+    }
+    switch (param) {
+    case PARAM_CLOCK_FREQ:
+      preset_.clockFreq = value;
+      break;
+    case PARAM_CLOCK_MULT:
+      preset_.clockMult = step;
+      break;
+    case PARAM_TRANSPOSE:
+      preset_.transpose = static_cast<int8_t>(value);
+      break;
+    case PARAM_ENV1_ATTACK:
+      preset_.env1Attack = clamp(value, 0.001f, 5.0f);
+      break;
+    case PARAM_ENV1_DECAY:
+      preset_.env1Decay = clamp(value, 0.001f, 5.0f);
+      break;
+    case PARAM_ENV2_ATTACK:
+      preset_.env2Attack = clamp(value, 0.001f, 5.0f);
+      break;
+    case PARAM_ENV2_DECAY:
+      preset_.env2Decay = clamp(value, 0.001f, 5.0f);
+      break;
+    case PARAM_ENV2_SCALE:
+      preset_.env2Scale = clamp(value, 0.0f, 1.0f);
+      break;
+    case PARAM_FILTER_FREQ:
+      preset_.filterFreq = clamp(value, 0.0f, 1.0f);
+      break;
+    case PARAM_FILTER_Q:
+      preset_.filterQ = clamp(value, 0.0f, 1.0f);
+      break;
+    case PARAM_SEQ1_TOGGLE:
+      preset_.seq1 ^= step < steps_ ? uint64_t(1) << step : 0;
+      break;
+    case PARAM_SEQ2_TOGGLE:
+      preset_.seq2 ^= step < steps_ ? uint64_t(1) << step : 0;
+      break;
+    case PARAM_OVERSAMPLE:
+      preset_.oversample = step < OVERSAMPLE_LAST ? step : OVERSAMPLE_OFF;
+      break;
+    case PARAM_FILTER_CORE:
+      preset_.filterCore = step < Filter::CORE_LAST ? step : 0;
+      break;
+    case PARAM_CONTROL_INTERVAL:
+      preset_.controlInterval = static_cast<uint16_t>(clamp(
+          value, 1.0f, float(ControlRate<Envelope>::maxInterval_)));
+      break;
+    default:
+      // eg play, not saved
+      return;
+    }
+    presetChanges_++;
+  }
+
+  // per track commands, same as setTrack on the preset's copy
+  void trackPresetTrack(uint8_t param, float value) {
+    uint8_t command = param - (param - PARAM_LENGTH) % TRACK_LAST;
+    uint8_t track = (param - PARAM_LENGTH) % TRACK_LAST;
+    // rotations can be negative
+    uint8_t amount = value < 0.0f ? 0 : static_cast<uint8_t>(value);
+    uint8_t &length = preset_.lengths[track];
+    uint64_t &sequence = track == TRACK_SEQ1 ? preset_.seq1 : preset_.seq2;
+    switch (command) {
+    case PARAM_LENGTH: {
+      uint8_t max = track == TRACK_PITCH ? steps_ : StepCounter::maxLength_;
+      amount = amount > max ? max : amount;
+      length = amount < 1 ? 1 : amount;
+      break;
+    }
+    case PARAM_DIRECTION:
+      preset_.directions[track] =
+          amount < StepCounter::DIR_LAST ? amount : StepCounter::DIR_FORWARD;
+      break;
+    case PARAM_DIVIDER:
+      amount = amount > StepCounter::maxDivider_ ? StepCounter::maxDivider_
+                                                 : amount;
+      preset_.dividers[track] = amount < 1 ? 1 : amount;
+      break;
+    case PARAM_ROTATE:
+      if (track == TRACK_PITCH) {
+        PitchSequencer<steps_>::RotateNotes(preset_.notes, length,
+                                            static_cast<int>(value));
+      } else {
+        sequence = TriggerSequencer::RotateSequence(sequence, length,
+                                                    static_cast<int>(value));
+      }
+      break;
+    case PARAM_FILL:
+      if (track != TRACK_PITCH) {
+        sequence = TriggerSequencer::FillSequence(sequence, length, amount);
+      }
+      break;
+    }
+  }
+
+  // knob smoothing, each parameter gets a setter called once per block
+  SmootherBank<8> smoothers_;
+
+  // external clock for the next block, see SyncClock
+  bool clockSynced_;
+  float syncBeats_, syncBeatsPerSample_;
+
+  void initSmoothers(float sr) {
+    // fast enough to feel instant, slow enough to remove zipper noise
+    const float knobTime = 0.02f;
+    smoothers_.Init(sr);
+    smoothers_.Add(
+        PARAM_FILTER_FREQ, filter.GetFreqIndex(), Smoother::SMOOTH_ONE_POLE,
+        knobTime,
+        [](void *p, float v) { static_cast<Patch *>(p)->filter.SetFreq(v); },
+        this);
+    smoothers_.Add(
+        PARAM_FILTER_Q, filter.GetQIndex(), Smoother::SMOOTH_ONE_POLE,
+        knobTime,
+        [](void *p, float v) { static_cast<Patch *>(p)->filter.SetQ(v); },
+        this);
+    smoothers_.Add(
+        PARAM_ENV1_ATTACK, env1.GetAttack(), Smoother::SMOOTH_ONE_POLE,
+        knobTime,
+        [](void *p, float v) { static_cast<Patch *>(p)->env1.SetAttack(v); },
+        this);
+    smoothers_.Add(
+        PARAM_ENV1_DECAY, env1.GetDecay(), Smoother::SMOOTH_ONE_POLE,
+        knobTime,
+        [](void *p, float v) { static_cast<Patch *>(p)->env1.SetDecay(v); },
+        this);
+    smoothers_.Add(
+        PARAM_ENV2_ATTACK, env2.GetAttack(), Smoother::SMOOTH_ONE_POLE,
+        knobTime,
+        [](void *p, float v) { static_cast<Patch *>(p)->env2.SetAttack(v); },
+        this);
+    smoothers_.Add(
+        PARAM_ENV2_DECAY, env2.GetDecay(), Smoother::SMOOTH_ONE_POLE,
+        knobTime,
+        [](void *p, float v) { static_cast<Patch *>(p)->env2.SetDecay(v); },
+        this);
+    smoothers_.Add(
+        PARAM_ENV2_SCALE, env2.GetScale(), Smoother::SMOOTH_ONE_POLE,
+        knobTime,
+        [](void *p, float v) { static_cast<Patch *>(p)->env2.SetScale(v); },
+        this);
+    // tempo changes glide at a constant speed, eg MIDI clock
+    smoothers_.Add(
+        PARAM_CLOCK_FREQ, clock.GetFreq(), Smoother::SMOOTH_LINEAR, 0.1f,
+        [](void *p, float v) { static_cast<Patch *>(p)->clock.SetFreq(v); },
+        this);
+  }
+
+  // more than one tick per block only happens with huge blocks and x16
+  static constexpr size_t maxTicks_ = 8;
+
+  // a clock tick, sequencers move (each at its own divider) and the voice
+  // is triggered, late is Clock::Tick::frac
+  void startStep(float late) {
+    bool seq1Moved = seq1.Advance();
+    bool seq2Moved = seq2.Advance();
+    bool pitchMoved = pitchSeq.Advance();
+    // seq2 resets seq1, when it lands on an active step
+    if (seq2Moved && seq2.IsCurrentStepActive()) {
+      seq1.Restart();
+      pitchSeq.Restart();
+      seq1Moved = pitchMoved = true;
+    }
+    movedTracks_ |= seq1Moved << TRACK_SEQ1 | seq2Moved << TRACK_SEQ2 |
+                    pitchMoved << TRACK_PITCH;
+
+    stepTime = 0;
+
+    if (seq1Moved && seq1.IsCurrentStepActive()) {
+      // sub-sample timing, the tick was a bit before this sample
+      env1.Trigger(late);
+      env2Control_.Trigger(late);
+      // set oscillator frequency, late in the oscillator's samples, it
+      // runs at the oversampled rate
+      uint8_t factor = oversample_ == OVERSAMPLE_OFF ? 1 : oversampleFactor_;
+      osc.SetFreq(pitchSeq.GetCurrentNoteHertz(), late * factor);
+    }
+  }
+
+  // voice buffers, each stage renders a whole segment before the next one
+  float env1Buf_[renderBlockSize_];
+  float env2Buf_[renderBlockSize_];
+  float oscBuf_[renderBlockSize_];
+
+  float sr_;
+  uint8_t oversample_;
+  // oversampled voice, envelopes are held for 2 samples
+  static constexpr size_t oversampleFactor_ = 2;
+  static constexpr size_t osBlockSize_ = oversampleFactor_ * renderBlockSize_;
+  float osEnv1Buf_[osBlockSize_];
+  float osEnv2Buf_[osBlockSize_];
+  float osBuf_[osBlockSize_];
+  HalfbandDecimator<16, renderBlockSize_> decimator_;
+
+  void setOversample(uint8_t quality) {
+    quality = quality < OVERSAMPLE_LAST ? quality : OVERSAMPLE_OFF;
+    oversample_ = quality;
+    uint8_t factor = quality == OVERSAMPLE_OFF ? 1 : oversampleFactor_;
+    osc.SetSampleRate(sr_ * factor);
+    filter.SetOversampling(factor);
+    // coefficient pairs, see HalfbandDecimator
+    size_t pairs = quality == OVERSAMPLE_BEST ? 16 : 8;
+    decimator_.Init(pairs);
+  }
+
+  /**
+   * Renders the voice from sample "from" up to (not including) sample "to"
+   * Nothing in the voice changes between clock ticks, so this is called
+   * once for every segment of the block between ticks
+   */
+  void renderVoice(float *out1, float *out2, size_t from, size_t to) {
+    if (oversample_ != OVERSAMPLE_OFF) {
+      renderVoiceOversampled(out1, out2, from, to);
+      return;
+    }
+    while (from < to) {
+      size_t n = to - from;
+      n = n > renderBlockSize_ ? renderBlockSize_ : n;
+
+      env1.ProcessBlock(env1Buf_, n);
+      env2Control_.ProcessBlock(env2Buf_, n);
+      osc.ProcessBlock(oscBuf_, env1Buf_, n);
+      for (size_t i = 0; i < n; i++) {
+        out1[from + i] = oscBuf_[i] * 0.50f;
+      }
+      float *outs[1] = {out1 + from};
+      filter.ProcessBlock(outs, env2Buf_, n);
+      std::copy(out1 + from, out1 + from + n, out2 + from);
+
+      from += n;
+    }
+  }
+
+  // same as renderVoice, oscillator and filter at twice the rate
+  void renderVoiceOversampled(float *out1, float *out2, size_t from,
+                              size_t to) {
+    while (from < to) {
+      size_t n = to - from;
+      n = n > renderBlockSize_ ? renderBlockSize_ : n;
+      size_t osN = n * oversampleFactor_;
+
+      env1.ProcessBlock(env1Buf_, n);
+      env2Control_.ProcessBlock(env2Buf_, n);
+      for (size_t i = 0; i < n; i++) {
+        osEnv1Buf_[2 * i] = osEnv1Buf_[2 * i + 1] = env1Buf_[i];
+        osEnv2Buf_[2 * i] = osEnv2Buf_[2 * i + 1] = env2Buf_[i];
+      }
+      osc.ProcessBlock(osBuf_, osEnv1Buf_, osN);
+      for (size_t i = 0; i < osN; i++) {
+        osBuf_[i] *= 0.50f;
+      }
+      float *bufs[1] = {osBuf_};
+      filter.ProcessBlock(bufs, osEnv2Buf_, osN);
+      // mono, decimated once
+      decimator_.ProcessBlock(osBuf_, out1 + from, n);
+      std::copy(out1 + from, out1 + from + n, out2 + from);
+
+      from += n;
+    }
+  }
+};
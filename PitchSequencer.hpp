@@ -1,45 +1,101 @@
 #pragma once
 
 #include "Quantizer.hpp"
-#include <vector>
+#include "StepCounter.hpp"
 
-class PitchSequencer {
+/**
+ * One note per step, stored inline, no heap
+ * Length, direction and divider are per track, see StepCounter
+ *
+ * @tparam MaxSteps how many steps fit
+ */
+template <uint8_t MaxSteps> class PitchSequencer {
 public:
+  static_assert(MaxSteps > 0 && MaxSteps <= StepCounter::maxLength_,
+                "1 to 64 steps");
+
   PitchSequencer() {}
   ~PitchSequencer() {}
 
   void Init(uint8_t steps) {
-    steps_ = steps;
+    counter_.Init(steps > MaxSteps ? MaxSteps : steps);
+    // A4 on every step until notes are set
+    for (uint8_t i = 0; i < MaxSteps; i++) {
+      sequenceNote_[i] = 69;
+    }
     quant_.Init();
-    currentStep_ = 0;
     transpose_ = 0;
   }
 
-  void Advance() {
-    // this way is better than % apparently
-    if (++currentStep_ > steps_ - 1) {
-      currentStep_ = 0;
+  // one clock tick, true if it moved to a new step, see StepCounter
+  bool Advance() { return counter_.Advance(); }
+  void Reset() { counter_.Reset(); }
+  void Restart() { counter_.Restart(); }
+
+  void SetNote(uint8_t step, uint8_t note) {
+    if (step < MaxSteps) {
+      sequenceNote_[step] = note;
     }
   }
-
-  void SetCurrentStep(uint8_t step) { currentStep_ = step; }
-  void SetNote(uint8_t step, uint8_t note) { sequenceNote_[step] = note; }
   void SetTranspose(int8_t transpose) { transpose_ = transpose; }
+  // rebuild the quantizer tables, not from the audio callback
+  void SetKey(uint8_t key) { quant_.SetKey(key); }
+  void SetScale(uint8_t scale) { quant_.SetScale(scale); }
+
+  // moves the notes inside the length later (negative is earlier)
+  void Rotate(int steps) {
+    RotateNotes(sequenceNote_, counter_.GetLength(), steps);
+  }
+
+  // 1 to MaxSteps
+  void SetLength(uint8_t length) {
+    counter_.SetLength(length > MaxSteps ? MaxSteps : length);
+  }
+  void SetDirection(uint8_t direction) { counter_.SetDirection(direction); }
+  void SetDivider(uint8_t divider) { counter_.SetDivider(divider); }
 
-  uint8_t GetCurrentStep() const { return currentStep_; }
+  uint8_t GetCurrentStep() const { return counter_.GetStep(); }
   float GetCurrentNoteHertz() {
-    return quant_.NoteToHertz(sequenceNote_[currentStep_] + transpose_);
+    return quant_.NoteToHertz(sequenceNote_[counter_.GetStep()] +
+                              transpose_);
   }
   int8_t GetTranspose() const { return transpose_; }
+  uint8_t GetNote(uint8_t step) const {
+    return step < MaxSteps ? sequenceNote_[step] : 0;
+  }
+  uint8_t GetKey() const { return quant_.GetKey(); }
+  uint8_t GetScale() const { return quant_.GetScale(); }
+  uint8_t GetLength() const { return counter_.GetLength(); }
+  uint8_t GetDirection() const { return counter_.GetDirection(); }
+  uint8_t GetDivider() const { return counter_.GetDivider(); }
 
   const char *StepToName(uint8_t step) {
     return quant_.NoteToName(sequenceNote_[step] + transpose_);
   }
+  // any note, key and scale only change with the audio stopped, so this
+  // is safe from the main loop
+  const char *NoteToName(uint8_t note) { return quant_.NoteToName(note); }
+
+  // Rotate on any MaxSteps notes, eg a preset's, same clamping
+  static void RotateNotes(uint8_t *notes, uint8_t length, int steps) {
+    length = length < 1 ? 1 : (length > MaxSteps ? MaxSteps : length);
+    int shift = steps % length;
+    shift = shift < 0 ? shift + length : shift;
+    if (shift == 0) {
+      return;
+    }
+    uint8_t rotated[MaxSteps];
+    for (uint8_t i = 0; i < length; i++) {
+      rotated[(i + shift) % length] = notes[i];
+    }
+    for (uint8_t i = 0; i < length; i++) {
+      notes[i] = rotated[i];
+    }
+  }
 
 private:
-  uint8_t steps_;
+  StepCounter counter_;
   Quantizer quant_;
-  uint8_t currentStep_;
-  std::vector<uint8_t> sequenceNote_;
+  uint8_t sequenceNote_[MaxSteps];
   int8_t transpose_;
-};
\ No newline at end of file
+};
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Everything that's saved: patterns, notes, transpose, key and scale and
+ * the synth parameters, see Patch::GetPreset and PresetStore
+ * Write and Read turn it into a compact payload, integers are varints and
+ * floats 4 bytes little endian, in a fixed order. New fields only ever go
+ * at the end and bump version_, so any version reads any other: missing
+ * fields keep their defaults and unknown ones are skipped
+ */
+struct Preset {
+  // version 1: the first one
+  // version 2: track lengths, directions and dividers
+  static constexpr uint8_t version_ = 2;
+  // largest payload, with every varint at its longest
+  static constexpr size_t maxBytes_ = 128;
+  static constexpr uint8_t maxSteps_ = 8;
+  // seq1, seq2 and pitch, see Patch::TRACK_
+  static constexpr uint8_t tracks_ = 3;
+
+  // patterns, bit n is step n
+  uint64_t seq1, seq2;
+  uint8_t notes[maxSteps_];
+  int8_t transpose;
+  uint8_t key, scale;
+  // synth, same units as the Patch params
+  float clockFreq;
+  uint8_t clockMult;
+  float env1Attack, env1Decay;
+  float env2Attack, env2Decay, env2Scale;
+  float filterFreq, filterQ;
+  uint8_t oversample, filterCore;
+  uint16_t controlInterval;
+  // per track, see StepCounter
+  uint8_t lengths[tracks_], directions[tracks_], dividers[tracks_];
+
+  /**
+   * @param out at least maxBytes_
+   * @return size_t bytes written
+   */
+  size_t Write(uint8_t *out) const {
+    Writer w = {out, 0};
+    w.Varint(seq1);
+    w.Varint(seq2);
+    for (uint8_t i = 0; i < maxSteps_; i++) {
+      w.Varint(notes[i]);
+    }
+    // zigzag, so small negative numbers stay small
+    w.Varint(transpose < 0 ? -2 * transpose - 1 : 2 * transpose);
+    w.Varint(key);
+    w.Varint(scale);
+    w.Float(clockFreq);
+    w.Varint(clockMult);
+    w.Float(env1Attack);
+    w.Float(env1Decay);
+    w.Float(env2Attack);
+    w.Float(env2Decay);
+    w.Float(env2Scale);
+    w.Float(filterFreq);
+    w.Float(filterQ);
+    w.Varint(oversample);
+    w.Varint(filterCore);
+    w.Varint(controlInterval);
+    for (uint8_t i = 0; i < tracks_; i++) {
+      w.Varint(lengths[i]);
+      w.Varint(directions[i]);
+      w.Varint(dividers[i]);
+    }
+    return w.size;
+  }
+
+  /**
+   * Reads a payload from any version over the current values, so whatever
+   * it doesn't have keeps its default
+   *
+   * @param version version_ of whoever wrote it, for when a field changes
+   * meaning instead of being added
+   * @return bool false if the payload is cut in the middle of a field
+   */
+  bool Read(const uint8_t *in, size_t size, uint8_t version) {
+    Reader r = {in, size, 0, true};
+    uint64_t value;
+    // every field is optional, stops at the end of the payload
+    if (r.Varint(value)) {
+      seq1 = value;
+    }
+    if (r.Varint(value)) {
+      seq2 = value;
+    }
+    for (uint8_t i = 0; i < maxSteps_; i++) {
+      if (r.Varint(value)) {
+        notes[i] = static_cast<uint8_t>(value);
+      }
+    }
+    if (r.Varint(value)) {
+      int zigzag = static_cast<int>(value);
+      transpose = static_cast<int8_t>(zigzag & 1 ? -(zigzag >> 1) - 1
+                                                 : zigzag >> 1);
+    }
+    if (r.Varint(value)) {
+      key = static_cast<uint8_t>(value);
+    }
+    if (r.Varint(value)) {
+      scale = static_cast<uint8_t>(value);
+    }
+    r.Float(clockFreq);
+    if (r.Varint(value)) {
+      clockMult = static_cast<uint8_t>(value);
+    }
+    r.Float(env1Attack);
+    r.Float(env1Decay);
+    r.Float(env2Attack);
+    r.Float(env2Decay);
+    r.Float(env2Scale);
+    r.Float(filterFreq);
+    r.Float(filterQ);
+    if (r.Varint(value)) {
+      oversample = static_cast<uint8_t>(value);
+    }
+    if (r.Varint(value)) {
+      filterCore = static_cast<uint8_t>(value);
+    }
+    if (r.Varint(value)) {
+      controlInterval = static_cast<uint16_t>(value);
+    }
+    for (uint8_t i = 0; i < tracks_; i++) {
+      if (r.Varint(value)) {
+        lengths[i] = static_cast<uint8_t>(value);
+      }
+      if (r.Varint(value)) {
+        directions[i] = static_cast<uint8_t>(value);
+      }
+      if (r.Varint(value)) {
+        dividers[i] = static_cast<uint8_t>(value);
+      }
+    }
+    // anything after this is from a newer version
+    return r.ok;
+  }
+
+private:
+  struct Writer {
+    uint8_t *out;
+    size_t size;
+    // 7 bits per byte, the top bit means more follow
+    void Varint(uint64_t value) {
+      while (value >= 0x80) {
+        out[size++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+      }
+      out[size++] = static_cast<uint8_t>(value);
+    }
+    void Float(float value) {
+      uint32_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      for (int i = 0; i < 4; i++) {
+        out[size++] = static_cast<uint8_t>(bits >> (8 * i));
+      }
+    }
+  };
+
+  // every read returns false at the end of the payload, ok is false if it
+  // ended in the middle of a field
+  struct Reader {
+    const uint8_t *in;
+    size_t size, pos;
+    bool ok;
+    bool Varint(uint64_t &value) {
+      if (pos >= size) {
+        return false;
+      }
+      value = 0;
+      for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= size) {
+          ok = false;
+          return false;
+        }
+        uint8_t byte = in[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+          return true;
+        }
+      }
+      ok = false;
+      return false;
+    }
+    bool Float(float &value) {
+      if (pos >= size) {
+        return false;
+      }
+      if (size - pos < 4) {
+        ok = false;
+        pos = size;
+        return false;
+      }
+      uint32_t bits = 0;
+      for (int i = 0; i < 4; i++) {
+        bits |= static_cast<uint32_t>(in[pos++]) << (8 * i);
+      }
+      memcpy(&value, &bits, sizeof(value));
+      return true;
+    }
+  };
+};
@@ -0,0 +1,335 @@
+#pragma once
+
+#include "Preset.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Keeps the last Preset in flash-like storage, saving never waits
+ * Every save is a new record after the previous one, so flash is only
+ * erased when a block is full. Two blocks take turns: the new one is only
+ * erased once the old one is full, so the last good record is always
+ * somewhere, even if the power goes in the middle of a write
+ * Saves are deferred: Save only takes the preset, Process writes it once
+ * it stopped changing for a while, one storage operation per call, from
+ * the idle part of the main loop
+ * Every storage operation blocks the caller until it's done. A record
+ * write is short, but an erase blocks for as long as the storage takes
+ * (about 50 ms on the QSPI: no knob scans or display updates for that
+ * long, the audio keeps going). The spare block is erased ahead, once
+ * nothing changed for idleEraseMs_, so a save is only a record write
+ * unless it comes before that
+ *
+ * Record: magic, version, payload size, sequence number, CRC, payload,
+ * padded to slotBytes_
+ *
+ * Storage needs:
+ *   size_t BlockSize(), bytes erased at once, the store uses 2 blocks
+ *   bool Read(offset, data, size)
+ *   bool Write(offset, data, size), only onto erased (0xFF) bytes
+ *   bool Erase(offset), sets the block starting at offset to 0xFF
+ *
+ * @tparam Storage QSPI flash on hardware, a file on Linux
+ */
+template <typename Storage> class PresetStore {
+public:
+  PresetStore() {}
+  ~PresetStore() {}
+
+  static constexpr uint16_t magic_ = 0xC05E;
+  static constexpr size_t headerBytes_ = 10;
+  // records start on a multiple of this
+  static constexpr size_t slotBytes_ = 16;
+  // a preset has to stop changing for this long before it's written
+  static constexpr uint32_t saveDelayMs_ = 2000;
+  // nothing changed for this long, the spare block is erased ahead
+  static constexpr uint32_t idleEraseMs_ = 10000;
+
+  void Init(Storage *storage) {
+    storage_ = storage;
+    blockSize_ = storage->BlockSize();
+    block_ = 0;
+    position_ = 0;
+    sequence_ = 0;
+    goodBlock_ = noBlock_;
+    spareErased_ = false;
+    pending_ = false;
+    changedAt_ = 0;
+    storedSize_ = 0;
+    ResetStats();
+  }
+
+  /**
+   * Finds the newest good record, call once at boot before Save
+   * Only headers are read to find the newest one, then only its payload
+   * is checked, older ones only if it's broken
+   *
+   * @param preset read over, keeps its defaults if nothing is found
+   * @return bool false if there's no good record
+   */
+  bool Load(Preset &preset) {
+    // newest first, below limit, until one is whole
+    uint32_t limit = UINT32_MAX;
+    Slot best = {};
+    // new records are numbered past every header, broken ones too, or
+    // the next one could tie with a record cut short
+    sequence_ = 0;
+    while (findNewest(limit, best, sequence_)) {
+      if (checkRecord(best.offset, best.header)) {
+        // new records go after this one
+        block_ = best.offset / blockSize_;
+        goodBlock_ = block_;
+        position_ = best.offset % blockSize_ + slotsFor(best.header.size);
+        storage_->Read(best.offset + headerBytes_, stored_, best.header.size);
+        storedSize_ = best.header.size;
+        return preset.Read(stored_, storedSize_, best.header.version);
+      }
+      limit = best.header.sequence;
+    }
+    return false;
+  }
+
+  /**
+   * Takes a preset to write later, nothing happens if it's what's stored
+   * Cheap, call it whenever the preset changed
+   *
+   * @param now milliseconds, any free running clock
+   */
+  void Save(const Preset &preset, uint32_t now) {
+    pendingSize_ = preset.Write(pendingPayload_);
+    pending_ = pendingSize_ != storedSize_ ||
+               memcmp(pendingPayload_, stored_, storedSize_) != 0;
+    changedAt_ = now;
+  }
+
+  /**
+   * Does at most one storage operation (an erase or one record write),
+   * see the class comment for how long they block
+   * Call from the main loop when it has nothing else to do
+   *
+   * @param now milliseconds, same clock as Save
+   * @return bool true if the storage was touched
+   */
+  bool Process(uint32_t now) {
+    if (!pending_) {
+      return now - changedAt_ >= idleEraseMs_ && eraseSpare();
+    }
+    if (now - changedAt_ < saveDelayMs_) {
+      return false;
+    }
+    size_t stride = slotsFor(pendingSize_);
+    if (position_ + stride > blockSize_ ||
+        !isErased(block_ * blockSize_ + position_, stride)) {
+      // full, or something half written is in the way, the other block
+      // still has the last good record until this one is written. If
+      // that's where the newest good record is, this one starts over
+      uint8_t other = block_ ^ 1;
+      bool again = other == goodBlock_;
+      block_ = again ? block_ : other;
+      position_ = 0;
+      if (again || !spareErased_) {
+        storage_->Erase(block_ * blockSize_);
+        erases_++;
+        spareErased_ = false;
+        return true;
+      }
+      // erased ahead, the write can go now
+      spareErased_ = false;
+    }
+    uint8_t record[headerBytes_ + Preset::maxBytes_];
+    Header header = {magic_, Preset::version_,
+                     static_cast<uint8_t>(pendingSize_), sequence_ + 1, 0};
+    memcpy(record + headerBytes_, pendingPayload_, pendingSize_);
+    header.crc = crc(header, record + headerBytes_);
+    writeHeader(header, record);
+    // numbers are never reused, even if the write fails
+    position_ += stride;
+    sequence_++;
+    if (!storage_->Write(block_ * blockSize_ + position_ - stride, record,
+                         headerBytes_ + pendingSize_)) {
+      // try again in the next slot, the good record stays where it is
+      return true;
+    }
+    goodBlock_ = block_;
+    memcpy(stored_, pendingPayload_, pendingSize_);
+    storedSize_ = pendingSize_;
+    pending_ = false;
+    writes_++;
+    return true;
+  }
+
+  // a preset is waiting to be written
+  bool Pending() const { return pending_; }
+
+  // stats
+  uint32_t GetWrites() const { return writes_; }
+  uint32_t GetErases() const { return erases_; }
+  size_t GetStoredBytes() const { return headerBytes_ + storedSize_; }
+  void ResetStats() { writes_ = erases_ = 0; }
+
+private:
+  Storage *storage_;
+  size_t blockSize_;
+  // where the next record goes
+  uint8_t block_;
+  size_t position_;
+  uint32_t sequence_;
+  // block with the newest good record, never erased
+  uint8_t goodBlock_;
+  static constexpr uint8_t noBlock_ = 2;
+  // the other block is erased and unused, see eraseSpare
+  bool spareErased_;
+
+  // last written payload, and the one waiting
+  uint8_t stored_[Preset::maxBytes_];
+  size_t storedSize_;
+  uint8_t pendingPayload_[Preset::maxBytes_];
+  size_t pendingSize_;
+  bool pending_;
+  uint32_t changedAt_;
+
+  uint32_t writes_, erases_;
+
+  struct Header {
+    uint16_t magic;
+    uint8_t version, size;
+    uint32_t sequence;
+    uint16_t crc;
+  };
+
+  struct Slot {
+    size_t offset;
+    Header header;
+  };
+
+  /**
+   * The record with the highest sequence number under limit, headers
+   * only, and the payload of two records with the same number, the whole
+   * one wins
+   *
+   * @param highest raised to the highest sequence number of any header
+   */
+  bool findNewest(uint32_t limit, Slot &newest, uint32_t &highest) {
+    bool found = false;
+    for (uint8_t block = 0; block < 2; block++) {
+      size_t start = block * blockSize_;
+      size_t position = 0;
+      Header header;
+      while (position + headerBytes_ <= blockSize_ &&
+             readHeader(start + position, header)) {
+        size_t stride = slotsFor(header.size);
+        if (position + stride > blockSize_) {
+          break;
+        }
+        highest = header.sequence > highest ? header.sequence : highest;
+        if (header.sequence < limit &&
+            (!found || header.sequence > newest.header.sequence ||
+             (header.sequence == newest.header.sequence &&
+              !checkRecord(newest.offset, newest.header) &&
+              checkRecord(start + position, header)))) {
+          found = true;
+          newest.offset = start + position;
+          newest.header = header;
+        }
+        position += stride;
+      }
+    }
+    return found;
+  }
+
+  // erases the other block once the next record won't fit in this one,
+  // unless it has the newest good record
+  bool eraseSpare() {
+    uint8_t other = block_ ^ 1;
+    if (spareErased_ || other == goodBlock_ ||
+        position_ + slotsFor(storedSize_) <= blockSize_) {
+      return false;
+    }
+    storage_->Erase(other * blockSize_);
+    erases_++;
+    spareErased_ = true;
+    return true;
+  }
+
+  size_t slotsFor(size_t payload) const {
+    size_t bytes = headerBytes_ + payload;
+    return (bytes + slotBytes_ - 1) / slotBytes_ * slotBytes_;
+  }
+
+  // little endian, same on every platform
+  static void writeHeader(const Header &header, uint8_t *out) {
+    out[0] = header.magic & 0xFF;
+    out[1] = header.magic >> 8;
+    out[2] = header.version;
+    out[3] = header.size;
+    for (int i = 0; i < 4; i++) {
+      out[4 + i] = static_cast<uint8_t>(header.sequence >> (8 * i));
+    }
+    out[8] = header.crc & 0xFF;
+    out[9] = header.crc >> 8;
+  }
+
+  // false if there's no record here (erased or garbage)
+  bool readHeader(size_t offset, Header &header) {
+    uint8_t in[headerBytes_];
+    if (!storage_->Read(offset, in, headerBytes_)) {
+      return false;
+    }
+    header.magic = in[0] | (in[1] << 8);
+    header.version = in[2];
+    header.size = in[3];
+    header.sequence = 0;
+    for (int i = 0; i < 4; i++) {
+      header.sequence |= static_cast<uint32_t>(in[4 + i]) << (8 * i);
+    }
+    header.crc = in[8] | (in[9] << 8);
+    return header.magic == magic_ && header.size <= Preset::maxBytes_;
+  }
+
+  // the payload is all there, eg not cut by a power loss
+  bool checkRecord(size_t offset, const Header &header) {
+    uint8_t payload[Preset::maxBytes_];
+    if (!storage_->Read(offset + headerBytes_, payload, header.size)) {
+      return false;
+    }
+    return crc(header, payload) == header.crc;
+  }
+
+  bool isErased(size_t offset, size_t size) {
+    uint8_t bytes[slotBytes_];
+    for (size_t done = 0; done < size; done += slotBytes_) {
+      if (!storage_->Read(offset + done, bytes, slotBytes_)) {
+        return false;
+      }
+      for (uint8_t byte : bytes) {
+        if (byte != 0xFF) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // CRC-16/CCITT over the header (without the CRC) and the payload
+  static uint16_t crc(const Header &header, const uint8_t *payload) {
+    uint8_t bytes[headerBytes_];
+    Header copy = header;
+    copy.crc = 0;
+    writeHeader(copy, bytes);
+    uint16_t crc = 0xFFFF;
+    auto add = [&crc](uint8_t byte) {
+      crc ^= static_cast<uint16_t>(byte) << 8;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+      }
+    };
+    for (size_t i = 0; i < headerBytes_ - 2; i++) {
+      add(bytes[i]);
+    }
+    for (size_t i = 0; i < header.size; i++) {
+      add(payload[i]);
+    }
+    return crc;
+  }
+};
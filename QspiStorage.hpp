@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstring>
+#include <daisy_seed.h>
+
+using namespace daisy;
+
+/**
+ * The last two 4 KB sectors of the Seed's QSPI flash, Storage for
+ * PresetStore. Reads go through the memory map (no waiting), erases and
+ * writes block the main loop while the flash is busy (about 50 ms for an
+ * erase, under 1 ms for a record), the audio runs from internal flash so
+ * it keeps going. Run after DaisyField::Init, which starts the QSPI
+ */
+class QspiStorage {
+public:
+  QspiStorage() {}
+  ~QspiStorage() {}
+
+  static constexpr size_t blockSize_ = 4096;
+  // 8 MB flash, the program is at the start, presets at the very end
+  static constexpr uint32_t offset_ = 0x800000 - 2 * blockSize_;
+  static constexpr uint32_t mappedBase_ = 0x90000000;
+
+  void Init(QSPIHandle *qspi) { qspi_ = qspi; }
+
+  size_t BlockSize() const { return blockSize_; }
+
+  bool Read(size_t offset, uint8_t *data, size_t size) {
+    if (offset + size > 2 * blockSize_) {
+      return false;
+    }
+    memcpy(data, static_cast<uint8_t *>(qspi_->GetData(offset_)) + offset,
+           size);
+    return true;
+  }
+
+  bool Write(size_t offset, const uint8_t *data, size_t size) {
+    if (offset + size > 2 * blockSize_) {
+      return false;
+    }
+    // libDaisy wants a non const buffer
+    uint8_t buffer[256];
+    size = size > sizeof(buffer) ? sizeof(buffer) : size;
+    memcpy(buffer, data, size);
+    return qspi_->Write(mappedBase_ + offset_ + offset, size, buffer) ==
+           QSPIHandle::Result::OK;
+  }
+
+  bool Erase(size_t offset) {
+    if (offset >= 2 * blockSize_) {
+      return false;
+    }
+    uint32_t start = mappedBase_ + offset_ + offset / blockSize_ * blockSize_;
+    return qspi_->Erase(start, start + blockSize_) == QSPIHandle::Result::OK;
+  }
+
+private:
+  QSPIHandle *qspi_;
+};
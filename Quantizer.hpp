@@ -1,7 +1,7 @@
 #pragma once
 
-#include <map>
-#include <string>
+#include <cmath>
+#include <cstdint>
 
 class Quantizer {
 public:
@@ -11,36 +11,35 @@ public:
   void Init() {
     qKey_ = 3;
     qScale_ = 3;
+    buildTables();
   }
 
-  void SetKey(uint8_t key) { qKey_ = key; }
-
-  void SetScale(uint8_t scale) { qScale_ = scale; }
-
-  uint8_t QuantizeNote(uint8_t note) {
-    note = (note < 21) ? 21 : (note > 108 ? 108 : note);
-    while (true) {
-      for (uint8_t increment : qScales[qScale_]) {
-        // - qKey_ to apply key
-        // - 21 because midi notes start from 21 but my scales start from 0
-        if ((note - qKey_ - 21) % 12 == increment) {
-          return note;
-        }
-      }
-      note++;
+  // tables are rebuilt here, so don't call from the audio callback
+  void SetKey(uint8_t key) {
+    key = key < 12 ? key : 0;
+    if (key != qKey_) {
+      qKey_ = key;
+      buildTables();
     }
   }
 
-  float NoteToHertz(uint8_t note) {
-    note = QuantizeNote(note);
-    // midi note to hertz
-    return 440.0f * pow(2.0f, (note - 69.0f) / 12.0f);
+  void SetScale(uint8_t scale) {
+    scale = scale < scalesCount_ ? scale : 0;
+    if (scale != qScale_) {
+      qScale_ = scale;
+      buildTables();
+    }
   }
 
+  uint8_t GetKey() const { return qKey_; }
+  uint8_t GetScale() const { return qScale_; }
+
+  uint8_t QuantizeNote(uint8_t note) { return quantized_[clampIndex(note)]; }
+
+  float NoteToHertz(uint8_t note) { return hertz_[clampIndex(note)]; }
+
   const char *NoteToName(uint8_t note) {
-    // - 21 because midi notes start from 21 but my scales start from 0
-    note = QuantizeNote(note) - 21;
-    return notes[note % 12];
+    return notes[nameIndex_[clampIndex(note)]];
   }
 
 private:
@@ -54,20 +53,58 @@ private:
   const char *notes[12] = {"A ", "A#", "B ", "C ", "C#", "D ",
                            "D#", "E ", "F ", "F#", "G ", "G#"};
 
-  std::map<int, std::array<int, 12>> qScales = {
+  static constexpr uint8_t scalesCount_ = 12;
+  const uint8_t qScales[scalesCount_][12] = {
       // I'm sure there's a better way to do this
-      {0, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}}, // Chromatic
-      {1, {0, 2, 4, 5, 7, 9, 11, 0, 0, 0, 0, 0}},  // Ionian (Natural Major)
-      {2, {0, 2, 4, 7, 9, 0, 0, 0, 0, 0, 0, 0}},   // Pentatonic Major
-      {3, {0, 2, 3, 5, 7, 8, 10, 0, 0, 0, 0, 0}},  // Aeolian (Natural Minor)
-      {4, {0, 2, 3, 5, 7, 8, 11, 0, 0, 0, 0, 0}},  // Harmonic Minor
-      {5, {0, 2, 3, 5, 7, 9, 11, 0, 0, 0, 0, 0}},  // Melodic Minor
-      {6, {0, 3, 5, 7, 10, 0, 0, 0, 0, 0, 0, 0}},  // Pentatonic Minor
-      {7, {0, 2, 3, 5, 7, 9, 10, 0, 0, 0, 0, 0}},  // Dorian
-      {8, {0, 1, 3, 5, 7, 8, 10, 0, 0, 0, 0, 0}},  // Phrygian
-      {9, {0, 2, 4, 6, 7, 9, 11, 0, 0, 0, 0, 0}},  // Lydian
-      {10, {0, 2, 4, 5, 7, 9, 10, 0, 0, 0, 0, 0}}, // Mixolydian
-      {11, {0, 1, 3, 5, 6, 8, 10, 0, 0, 0, 0, 0}}, // Locrian
-                                                   // Fifth, I, IV, V chords?
+      {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}, // Chromatic
+      {0, 2, 4, 5, 7, 9, 11, 0, 0, 0, 0, 0},  // Ionian (Natural Major)
+      {0, 2, 4, 7, 9, 0, 0, 0, 0, 0, 0, 0},   // Pentatonic Major
+      {0, 2, 3, 5, 7, 8, 10, 0, 0, 0, 0, 0},  // Aeolian (Natural Minor)
+      {0, 2, 3, 5, 7, 8, 11, 0, 0, 0, 0, 0},  // Harmonic Minor
+      {0, 2, 3, 5, 7, 9, 11, 0, 0, 0, 0, 0},  // Melodic Minor
+      {0, 3, 5, 7, 10, 0, 0, 0, 0, 0, 0, 0},  // Pentatonic Minor
+      {0, 2, 3, 5, 7, 9, 10, 0, 0, 0, 0, 0},  // Dorian
+      {0, 1, 3, 5, 7, 8, 10, 0, 0, 0, 0, 0},  // Phrygian
+      {0, 2, 4, 6, 7, 9, 11, 0, 0, 0, 0, 0},  // Lydian
+      {0, 2, 4, 5, 7, 9, 10, 0, 0, 0, 0, 0},  // Mixolydian
+      {0, 1, 3, 5, 6, 8, 10, 0, 0, 0, 0, 0},  // Locrian
+                                              // Fifth, I, IV, V chords?
   };
+
+  // one entry for every midi note, for the current key and scale
+  static constexpr uint8_t tableSize_ = 128;
+  uint8_t quantized_[tableSize_];
+  float hertz_[tableSize_];
+  uint8_t nameIndex_[tableSize_];
+
+  // everything above the table is clamped to 108 anyway
+  static uint8_t clampIndex(uint8_t note) {
+    return note < tableSize_ ? note : tableSize_ - 1;
+  }
+
+  bool inScale(int note) {
+    for (uint8_t increment : qScales[qScale_]) {
+      // - qKey_ to apply key
+      // - 21 because midi notes start from 21 but my scales start from 0
+      if ((note - qKey_ - 21) % 12 == increment) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void buildTables() {
+    for (int i = 0; i < tableSize_; i++) {
+      // clamp to the notes on the keyboard, then go up to the scale
+      int note = (i < 21) ? 21 : (i > 108 ? 108 : i);
+      while (!inScale(note)) {
+        note++;
+      }
+      quantized_[i] = note;
+      // midi note to hertz, in double since it's not per sample anymore
+      hertz_[i] = 440.0f * pow(2.0, (note - 69.0f) / 12.0f);
+      // - 21 because midi notes start from 21 but my scales start from 0
+      nameIndex_[i] = (note - 21) % 12;
+    }
+  }
 };
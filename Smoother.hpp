@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Parameter smoother that moves once per block instead of once per sample
+ * ONE_POLE: exponential, fast at first then settles, good for knobs
+ * LINEAR: constant speed, always takes the same time, good for tempo
+ */
+class Smoother {
+public:
+  Smoother() {}
+  ~Smoother() {}
+
+  enum { SMOOTH_ONE_POLE, SMOOTH_LINEAR, SMOOTH_LAST };
+
+  /**
+   * @param value starting value
+   * @param type SMOOTH_ONE_POLE or SMOOTH_LINEAR
+   * @param time seconds, time constant for one pole, full glide for linear
+   * @param sr sample rate
+   */
+  void Init(float value, uint8_t type, float time, float sr) {
+    value_ = target_ = value;
+    type_ = type < SMOOTH_LAST ? type : SMOOTH_ONE_POLE;
+    rate_ = 0.0f;
+    SetTime(time, sr);
+  }
+
+  void SetTime(float time, float sr) {
+    time_ = time;
+    samples_ = time * sr;
+    samples_ = samples_ < 1.0f ? 1.0f : samples_;
+    // recalculate coefficients on the next block
+    blockSize_ = 0;
+  }
+
+  // same time at the new rate, a glide in progress keeps going
+  void SetSampleRate(float sr) {
+    SetTime(time_, sr);
+    if (type_ == SMOOTH_LINEAR) {
+      rate_ = fabsf(target_ - value_) / samples_;
+    }
+  }
+
+  void SetTarget(float target) {
+    target_ = target;
+    // linear, whole distance in "samples_"
+    rate_ = fabsf(target_ - value_) / samples_;
+  }
+
+  // jumps to value, no smoothing
+  void Reset(float value) { value_ = target_ = value; }
+
+  /**
+   * Moves forward by one block
+   *
+   * @param size block size in samples
+   * @return bool true if the value changed
+   */
+  bool Process(size_t size) {
+    if (value_ == target_) {
+      return false;
+    }
+    if (size != blockSize_) {
+      // only when the block size changes
+      blockSize_ = size;
+      blockCoeff_ = -expm1f(-(size / samples_));
+    }
+
+    float diff = target_ - value_;
+    if (type_ == SMOOTH_LINEAR) {
+      float step = rate_ * size;
+      value_ = fabsf(diff) <= step ? target_
+                                   : value_ + (diff > 0.0f ? step : -step);
+    } else {
+      value_ += diff * blockCoeff_;
+      // close enough, stop moving
+      if (fabsf(target_ - value_) <= 0.0001f * fabsf(target_) + 1e-6f) {
+        value_ = target_;
+      }
+    }
+    return true;
+  }
+
+  float Get() const { return value_; }
+  float GetTarget() const { return target_; }
+  bool IsMoving() const { return value_ != target_; }
+
+private:
+  uint8_t type_;
+  float value_, target_;
+  // smoothing time in seconds and in samples
+  float time_, samples_;
+  // linear, distance per sample
+  float rate_;
+  // one pole, coefficient for the current block size
+  size_t blockSize_;
+  float blockCoeff_;
+};
+
+/**
+ * Smoothers for a set of parameters, each one calls a setter with the
+ * smoothed value once per block, only while it's moving
+ *
+ * @tparam Capacity max parameters
+ */
+template <size_t Capacity> class SmootherBank {
+public:
+  SmootherBank() {}
+  ~SmootherBank() {}
+
+  // called with the smoothed value, context is whatever was passed to Add
+  typedef void (*Setter)(void *context, float value);
+
+  void Init(float sr) {
+    sr_ = sr;
+    count_ = 0;
+  }
+
+  /**
+   * Registers a parameter
+   *
+   * @param id parameter id, used by SetTarget
+   * @param value current value
+   * @param type Smoother::SMOOTH_ONE_POLE or Smoother::SMOOTH_LINEAR
+   * @param time smoothing time in seconds
+   * @param setter applies the value, eg to a filter
+   * @param context passed to setter
+   * @return bool false if the bank is full
+   */
+  bool Add(uint8_t id, float value, uint8_t type, float time, Setter setter,
+           void *context) {
+    if (count_ >= Capacity) {
+      return false;
+    }
+    Entry &entry = entries_[count_++];
+    entry.id = id;
+    entry.smoother.Init(value, type, time, sr_);
+    entry.setter = setter;
+    entry.context = context;
+    return true;
+  }
+
+  /**
+   * @return bool false if the parameter isn't registered
+   */
+  bool SetTarget(uint8_t id, float target) {
+    Smoother *smoother = Find(id);
+    if (!smoother) {
+      return false;
+    }
+    smoother->SetTarget(target);
+    return true;
+  }
+
+  Smoother *Find(uint8_t id) {
+    for (size_t i = 0; i < count_; i++) {
+      if (entries_[i].id == id) {
+        return &entries_[i].smoother;
+      }
+    }
+    return nullptr;
+  }
+
+  void SetSampleRate(float sr) {
+    sr_ = sr;
+    for (size_t i = 0; i < count_; i++) {
+      entries_[i].smoother.SetSampleRate(sr);
+    }
+  }
+
+  // once per block, before rendering
+  void Process(size_t size) {
+    for (size_t i = 0; i < count_; i++) {
+      Entry &entry = entries_[i];
+      if (entry.smoother.Process(size)) {
+        entry.setter(entry.context, entry.smoother.Get());
+      }
+    }
+  }
+
+private:
+  struct Entry {
+    uint8_t id;
+    Smoother smoother;
+    Setter setter;
+    void *context;
+  };
+  float sr_;
+  size_t count_ = 0;
+  Entry entries_[Capacity];
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Lock-free queue for one producer and one consumer, eg main loop to
+ * AudioCallback. Fixed size, no heap, no locks, never blocks
+ *
+ * @tparam T item type, copied in and out
+ * @tparam Capacity max items waiting, power of 2
+ */
+template <typename T, size_t Capacity> class SpscQueue {
+public:
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of 2");
+
+  SpscQueue() {}
+  ~SpscQueue() {}
+
+  /**
+   * Producer side
+   *
+   * @return bool false if the queue is full, the item is dropped
+   */
+  bool Push(const T &item) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == Capacity) {
+      return false;
+    }
+    items_[head & (Capacity - 1)] = item;
+    // item is written before the consumer can see it
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Consumer side
+   *
+   * @return bool false if there was nothing to pop
+   */
+  bool Pop(T &item) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = items_[tail & (Capacity - 1)];
+    // slot is read before the producer can reuse it
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool IsEmpty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+private:
+  T items_[Capacity];
+  // free running counters, wrap around on their own
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+};
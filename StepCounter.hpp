@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Where a sequencer track is: length, direction and clock divider, so
+ * tracks of different lengths and speeds run side by side (polymeter)
+ * A few compares per clock tick, no tables
+ */
+class StepCounter {
+public:
+  StepCounter() {}
+  ~StepCounter() {}
+
+  static constexpr uint8_t maxLength_ = 64;
+  static constexpr uint8_t maxDivider_ = 16;
+
+  // FORWARD: 0 1 2 3 0 1 ...
+  // BACKWARD: 3 2 1 0 3 2 ...
+  // PINGPONG: 0 1 2 3 2 1 0 1 ..., the ends play once
+  enum { DIR_FORWARD, DIR_BACKWARD, DIR_PINGPONG, DIR_LAST };
+
+  void Init(uint8_t length) {
+    direction_ = DIR_FORWARD;
+    divider_ = 1;
+    SetLength(length);
+    Reset();
+  }
+
+  // the next Advance lands on the first step
+  void Reset() {
+    count_ = 0;
+    armed_ = true;
+    backwards_ = direction_ == DIR_BACKWARD;
+    step_ = firstStep();
+  }
+
+  // on the first step right now, eg reset by another track, it stays
+  // there for a full divider
+  void Restart() {
+    Reset();
+    armed_ = false;
+    count_ = divider_ - 1;
+  }
+
+  /**
+   * One clock tick, the step moves every "divider" ticks
+   *
+   * @return bool true if it moved, so the new step should play
+   */
+  bool Advance() {
+    if (count_ > 0) {
+      count_--;
+      return false;
+    }
+    count_ = divider_ - 1;
+    if (armed_) {
+      // the length could have changed since Reset
+      step_ = firstStep();
+      armed_ = false;
+      return true;
+    }
+    if (!backwards_) {
+      if (++step_ >= length_) {
+        // pingpong turns around before the end plays twice
+        bool turn = direction_ == DIR_PINGPONG && length_ > 1;
+        step_ = turn ? length_ - 2 : 0;
+        backwards_ = turn;
+      }
+    } else if (step_ == 0) {
+      bool turn = direction_ == DIR_PINGPONG && length_ > 1;
+      step_ = turn ? 1 : length_ - 1;
+      backwards_ = !turn;
+    } else {
+      step_--;
+    }
+    return true;
+  }
+
+  // 1 to maxLength_, the step wraps if it's past the new end
+  void SetLength(uint8_t length) {
+    length_ = length < 1 ? 1 : (length > maxLength_ ? maxLength_ : length);
+    step_ = step_ < length_ ? step_ : step_ % length_;
+  }
+
+  // DIR_, from the current step
+  void SetDirection(uint8_t direction) {
+    direction_ = direction < DIR_LAST ? direction : DIR_FORWARD;
+    backwards_ = direction_ == DIR_BACKWARD;
+  }
+
+  // clock ticks per step, 1 to maxDivider_
+  void SetDivider(uint8_t divider) {
+    divider_ =
+        divider < 1 ? 1 : (divider > maxDivider_ ? maxDivider_ : divider);
+    count_ = count_ < divider_ ? count_ : divider_ - 1;
+  }
+
+  uint8_t GetStep() const { return step_; }
+  uint8_t GetLength() const { return length_; }
+  uint8_t GetDirection() const { return direction_; }
+  uint8_t GetDivider() const { return divider_; }
+
+private:
+  uint8_t step_ = 0, length_, direction_, divider_;
+  // ticks left before the next move
+  uint8_t count_;
+  // reset, the next move goes to the first step
+  bool armed_;
+  // going down, backward or the second half of pingpong
+  bool backwards_;
+
+  uint8_t firstStep() const {
+    return direction_ == DIR_BACKWARD ? length_ - 1 : 0;
+  }
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "utilities.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Zero delay feedback (topology preserving) state variable filter math,
+ * the SVF core of MultiFilter
+ * Coefficients come straight from the cutoff with one tan approximation
+ * and one division, cheap enough to do on every sample, so there's no
+ * table. Stable for any cutoff and Q, however fast they move. Lowpass,
+ * bandpass and highpass come out of the same step, the lowpass is the
+ * same response as the table biquad (both are bilinear with prewarping)
+ *
+ * See "Solving the continuous SVF equations using trapezoidal
+ * integration and equivalent currents", A. Simper (Cytomic)
+ */
+class Svf {
+public:
+  struct Coeffs {
+    float a1, a2, a3, k;
+  };
+
+  /**
+   * @param x pi * cutoff / sample rate, 0 to almost pi / 2
+   * @param k 1 / Q
+   */
+  static Coeffs Make(float x, float k) {
+    // g = tan(x) = n / d, folded into the single division
+    float x2 = x * x;
+    float n = x * (945.0f + x2 * (x2 - 105.0f));
+    float d = 945.0f + x2 * (15.0f * x2 - 420.0f);
+    float inv = 1.0f / (d * d + n * (n + k * d));
+    Coeffs c;
+    c.a1 = d * d * inv;
+    c.a2 = n * d * inv;
+    c.a3 = n * n * inv;
+    c.k = k;
+    return c;
+  }
+
+  /**
+   * One step, ic1 and ic2 are the state
+   *
+   * @param band bandpass out, unity gain at the cutoff
+   * @param high highpass out
+   * @return float lowpass out
+   */
+  static inline float Tick(const Coeffs &c, float in, float &ic1, float &ic2,
+                           float &band, float &high) {
+    float v3 = in - ic2;
+    float v1 = c.a1 * ic1 + c.a2 * v3;
+    float v2 = ic2 + c.a2 * ic1 + c.a3 * v3;
+    ic1 = 2.0f * v1 - ic1;
+    ic2 = 2.0f * v2 - ic2;
+    band = v1;
+    high = in - c.k * v1 - v2;
+    return v2;
+  }
+
+  // 2^x, about 1.5e-4 relative error (a quarter of a cent), for cutoffs
+  static float Exp2(float x) {
+    // floor, without the library call
+    int32_t whole = static_cast<int32_t>(x);
+    whole -= x < whole ? 1 : 0;
+    float f = x - whole;
+    float p = 1.0f + f * (0.6960656f + f * (0.2244943f + f * 0.0794402f));
+    // whole goes straight into the exponent
+    int32_t bits;
+    memcpy(&bits, &p, sizeof(bits));
+    bits += whole * (1 << 23);
+    memcpy(&p, &bits, sizeof(p));
+    return p;
+  }
+};
@@ -1,35 +1,147 @@
 #pragma once
 
-#include <vector>
+#include "StepCounter.hpp"
+#include <cstdint>
 
+/**
+ * On/off steps, one bit each in a 64 bit mask, no heap
+ * Length, direction and divider are per track, see StepCounter. Checking,
+ * toggling and rotating steps are shifts and masks, Euclidean fills come
+ * from patterns worked out at compile time
+ */
 class TriggerSequencer {
 public:
   TriggerSequencer() {}
   ~TriggerSequencer() {}
 
-  void Init(uint8_t steps) {
-    steps_ = steps;
-    currentStep_ = 0;
-    sequence_.resize(steps_, false);
+  static constexpr uint8_t maxSteps_ = StepCounter::maxLength_;
+
+  void Init(uint8_t length) {
+    counter_.Init(length);
+    sequence_ = 0;
   }
 
-  void Advance() {
-    // this way is better than % apparently
-    if (++currentStep_ > steps_ - 1) {
-      currentStep_ = 0;
+  // one clock tick, true if it moved to a new step, see StepCounter
+  bool Advance() { return counter_.Advance(); }
+  void Reset() { counter_.Reset(); }
+  void Restart() { counter_.Restart(); }
+
+  void ToggleStep(uint8_t step) {
+    if (step < maxSteps_) {
+      sequence_ ^= bit(step);
     }
   }
 
-  void ToggleStep(uint8_t step) { sequence_[step] = !sequence_[step]; }
+  // all steps at once, bit n is step n, eg from a preset
+  void SetSequence(uint64_t sequence) { sequence_ = sequence; }
+
+  /**
+   * Moves every step inside the length later (negative is earlier), the
+   * end wraps to the start. Steps past the length stay where they are
+   */
+  void Rotate(int steps) {
+    sequence_ = RotateSequence(sequence_, counter_.GetLength(), steps);
+  }
+
+  // Euclidean rhythm over the length, hits as evenly spaced as they go,
+  // the first step is always one. Steps past the length stay
+  void Fill(uint8_t hits) {
+    sequence_ = FillSequence(sequence_, counter_.GetLength(), hits);
+  }
+
+  void SetLength(uint8_t length) { counter_.SetLength(length); }
+  void SetDirection(uint8_t direction) { counter_.SetDirection(direction); }
+  void SetDivider(uint8_t divider) { counter_.SetDivider(divider); }
+
+  uint8_t GetCurrentStep() const { return counter_.GetStep(); }
+  uint8_t GetLength() const { return counter_.GetLength(); }
+  uint8_t GetDirection() const { return counter_.GetDirection(); }
+  uint8_t GetDivider() const { return counter_.GetDivider(); }
+  bool IsStepActive(uint8_t step) const {
+    return step < maxSteps_ && (sequence_ >> step) & 1;
+  }
+  bool IsCurrentStepActive() const {
+    return (sequence_ >> counter_.GetStep()) & 1;
+  }
+  uint64_t GetSequence() const { return sequence_; }
+
+  // Rotate on any mask, eg a preset's, same clamping
+  static uint64_t RotateSequence(uint64_t sequence, uint8_t length,
+                                 int steps) {
+    length = length < 1 ? 1 : (length > maxSteps_ ? maxSteps_ : length);
+    int shift = steps % length;
+    shift = shift < 0 ? shift + length : shift;
+    if (shift == 0) {
+      return sequence;
+    }
+    uint64_t inside = lengthMask(length);
+    uint64_t window = sequence & inside;
+    uint64_t rotated = (window << shift) | (window >> (length - shift));
+    return (sequence & ~inside) | (rotated & inside);
+  }
 
-  void SetCurrentStep(uint8_t step) { currentStep_ = step; }
+  // Fill on any mask
+  static uint64_t FillSequence(uint64_t sequence, uint8_t length,
+                               uint8_t hits) {
+    length = length < 1 ? 1 : (length > maxSteps_ ? maxSteps_ : length);
+    return (sequence & ~lengthMask(length)) | Euclid(hits, length);
+  }
 
-  uint8_t GetCurrentStep() const { return currentStep_; }
-  bool IsStepActive(uint8_t step) { return sequence_[step]; }
-  bool IsCurrentStepActive() const { return sequence_[currentStep_]; }
+  /**
+   * @param hits active steps, up to length
+   * @param length steps in the pattern, 1 to maxSteps_
+   * @return uint64_t bit n is step n
+   */
+  static uint64_t Euclid(uint8_t hits, uint8_t length);
 
 private:
-  uint8_t steps_;
-  uint8_t currentStep_;
-  std::vector<bool> sequence_;
-};
\ No newline at end of file
+  StepCounter counter_;
+  uint64_t sequence_;
+
+  static uint64_t bit(uint8_t step) {
+    return static_cast<uint64_t>(1) << step;
+  }
+  static constexpr uint64_t lengthMask(uint8_t length) {
+    return length >= 64 ? ~static_cast<uint64_t>(0)
+                        : (static_cast<uint64_t>(1) << length) - 1;
+  }
+
+  // step i is a hit when i * hits wraps past a multiple of length, same
+  // spacing as Bjorklund's algorithm, rotated to start on a hit
+  static constexpr uint64_t euclid(uint8_t hits, uint8_t length) {
+    uint64_t pattern = 0;
+    for (uint8_t i = 0; i < length; i++) {
+      if ((i * hits) % length < hits) {
+        pattern |= static_cast<uint64_t>(1) << i;
+      }
+    }
+    return pattern;
+  }
+
+  // every hits/length pair up to euclidTableSteps_ (a triangle, 2.2 KB),
+  // longer ones are worked out when asked, they're rare
+  static constexpr uint8_t euclidTableSteps_ = 32;
+  struct EuclidTable {
+    uint32_t patterns[(euclidTableSteps_ + 1) * (euclidTableSteps_ + 2) / 2];
+    constexpr EuclidTable() : patterns() {
+      for (uint8_t length = 0; length <= euclidTableSteps_; length++) {
+        for (uint8_t hits = 0; hits <= length; hits++) {
+          patterns[length * (length + 1) / 2 + hits] =
+              length == 0 ? 0 : static_cast<uint32_t>(euclid(hits, length));
+        }
+      }
+    }
+  };
+};
+
+// out of the class, the table can only be built once the class is complete
+inline uint64_t TriggerSequencer::Euclid(uint8_t hits, uint8_t length) {
+  length = length < 1 ? 1 : (length > maxSteps_ ? maxSteps_ : length);
+  hits = hits > length ? length : hits;
+  if (length > euclidTableSteps_) {
+    return euclid(hits, length);
+  }
+  // constant, in flash, nothing to build at boot
+  static constexpr EuclidTable table{};
+  return table.patterns[length * (length + 1) / 2 + hits];
+}
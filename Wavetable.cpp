@@ -0,0 +1,116 @@
+#include "Wavetable.hpp"
+#include "FastSine.hpp"
+
+// sin(2pi * index / tableSize_), index wraps
+static float tableSin(size_t index) {
+  return FastSine::Poly(float(index & (Wavetable::tableSize_ - 1)) /
+                        Wavetable::tableSize_);
+}
+static float tableCos(size_t index) {
+  return tableSin(index + Wavetable::tableSize_ / 4);
+}
+
+void Wavetable::Init(uint8_t wave) {
+  wave = wave < WAVE_LAST ? wave : WAVE_SINE;
+  for (size_t h = 0; h <= tableSize_ / 2; h++) {
+    cos_[h] = 0.0f;
+    sin_[h] = 0.0f;
+  }
+  // same shapes and phases as the naive Oscillator modes
+  for (size_t h = 1; h <= tableSize_ / 2; h++) {
+    bool odd = h & 1;
+    switch (wave) {
+    case WAVE_SINE:
+      sin_[h] = h == 1 ? 1.0f : 0.0f;
+      break;
+    case WAVE_TRI:
+      // starts at the top, cosines only
+      cos_[h] = odd ? 8.0f / (PI_F * PI_F * h * h) : 0.0f;
+      break;
+    case WAVE_SQUARE:
+      sin_[h] = odd ? 4.0f / (PI_F * h) : 0.0f;
+      break;
+    case WAVE_SAW:
+      // rising, -1 to 1
+      sin_[h] = -2.0f / (PI_F * h);
+      break;
+    }
+  }
+  buildLevels();
+}
+
+void Wavetable::Load(const float *samples, size_t size) {
+  if (size < 2) {
+    Init(WAVE_SINE);
+    return;
+  }
+  // resample to the table size, level 0 is free to use until buildLevels
+  float *wave = table_[0];
+  float step = float(size) / tableSize_;
+  for (size_t i = 0; i < tableSize_; i++) {
+    float pos = i * step;
+    size_t j = static_cast<size_t>(pos);
+    float frac = pos - j;
+    float next = samples[(j + 1) % size];
+    wave[i] = samples[j] + frac * (next - samples[j]);
+  }
+
+  // plain DFT, only done when loading so speed doesn't matter much
+  cos_[0] = sin_[0] = 0.0f;
+  for (size_t h = 1; h <= tableSize_ / 2; h++) {
+    float c = 0.0f, s = 0.0f;
+    for (size_t i = 0; i < tableSize_; i++) {
+      c += wave[i] * tableCos(h * i);
+      s += wave[i] * tableSin(h * i);
+    }
+    // Nyquist only has a cosine part, and half the weight
+    float scale = h == tableSize_ / 2 ? 1.0f : 2.0f;
+    cos_[h] = c * scale / tableSize_;
+    sin_[h] = s * scale / tableSize_;
+  }
+  buildLevels();
+}
+
+void Wavetable::buildLevels() {
+  // from the sine up, every level is the one after it plus the
+  // harmonics that level didn't have
+  for (int level = levels_ - 1; level >= 0; level--) {
+    float *out = table_[level];
+    size_t first = 1;
+    if (level < levels_ - 1) {
+      for (size_t i = 0; i < tableSize_; i++) {
+        out[i] = table_[level + 1][i];
+      }
+      first = ((tableSize_ / 2) >> (level + 1)) + 1;
+    } else {
+      for (size_t i = 0; i < tableSize_; i++) {
+        out[i] = 0.0f;
+      }
+    }
+    size_t last = (tableSize_ / 2) >> level;
+    for (size_t h = first; h <= last; h++) {
+      if (cos_[h] == 0.0f && sin_[h] == 0.0f) {
+        continue;
+      }
+      for (size_t i = 0; i < tableSize_; i++) {
+        out[i] += cos_[h] * tableCos(h * i) + sin_[h] * tableSin(h * i);
+      }
+    }
+  }
+
+  // one gain for every level, so notes are as loud in every octave
+  float peak = 0.0f;
+  for (int level = 0; level < levels_; level++) {
+    for (size_t i = 0; i < tableSize_; i++) {
+      float a = fabsf(table_[level][i]);
+      peak = a > peak ? a : peak;
+    }
+  }
+  float gain = peak > 0.0f ? 1.0f / peak : 0.0f;
+  for (int level = 0; level < levels_; level++) {
+    for (size_t i = 0; i < tableSize_; i++) {
+      table_[level][i] *= gain;
+    }
+    table_[level][tableSize_] = table_[level][0];
+  }
+}
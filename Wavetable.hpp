@@ -0,0 +1,91 @@
+#pragma once
+
+#include "utilities.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Single cycle wave for Oscillator MODE_WT, band limited per octave
+ * Level 0 has every harmonic that fits in the table, each level after it
+ * has half the harmonics of the one before, down to a sine. All levels are
+ * made once by Init or Load, the oscillator only looks them up
+ *
+ * About 41 KB, on the Field keep it in SDRAM (DSY_SDRAM_BSS)
+ */
+class Wavetable {
+public:
+  Wavetable() {}
+  ~Wavetable() {}
+
+  static constexpr size_t tableSize_ = 1024;
+  // 512 harmonics down to 1
+  static constexpr uint8_t levels_ = 10;
+
+  enum { WAVE_SINE, WAVE_TRI, WAVE_SQUARE, WAVE_SAW, WAVE_LAST };
+
+  /**
+   * Builds one of the standard waves from its harmonic series
+   *
+   * @param wave WAVE_ from the list above
+   */
+  void Init(uint8_t wave);
+
+  /**
+   * Builds the levels from any single cycle wave, eg a sample
+   * The wave is resampled to the table size and split into harmonics,
+   * DC is removed and the result is normalized to -1 to 1
+   *
+   * @param samples one cycle
+   * @param size number of samples, at least 2
+   */
+  void Load(const float *samples, size_t size);
+
+  /**
+   * Picks the levels for a phase increment, call when the frequency changes
+   * Crossfades between the two levels under Nyquist, so notes don't jump
+   * in brightness at octave boundaries
+   *
+   * @param phaseInc oscillator phase increment per sample (0 to 1)
+   * @param level first level, fades to level + 1
+   * @param fade how much of level + 1, 0 to 1
+   */
+  static void FindLevels(float phaseInc, uint8_t &level, float &fade) {
+    // harmonics that fit under Nyquist halve every octave
+    float pos = log2f(phaseInc * tableSize_) + 1.0f;
+    pos = (pos < 0.0f) ? 0.0f : (pos > levels_ - 1 ? levels_ - 1 : pos);
+    level = static_cast<uint8_t>(pos);
+    level = level > levels_ - 2 ? levels_ - 2 : level;
+    fade = pos - level;
+  }
+
+  /**
+   * @param phase 0 to 1
+   * @param level see FindLevels
+   * @param fade see FindLevels
+   */
+  float Process(float phase, uint8_t level, float fade) const {
+    float pos = phase * tableSize_;
+    int i = static_cast<int>(pos);
+    float frac = pos - i;
+    // wraps phase 1.0 back to 0
+    i &= tableSize_ - 1;
+    const float *a = table_[level] + i;
+    const float *b = table_[level + 1] + i;
+    float outA = a[0] + frac * (a[1] - a[0]);
+    float outB = b[0] + frac * (b[1] - b[0]);
+    return outA + fade * (outB - outA);
+  }
+
+  const float *GetLevel(uint8_t level) const { return table_[level]; }
+
+private:
+  // + 1 so interpolation doesn't need to wrap
+  float table_[levels_][tableSize_ + 1];
+  // harmonics, cos and sin parts, index 0 (DC) is never used
+  float cos_[tableSize_ / 2 + 1];
+  float sin_[tableSize_ / 2 + 1];
+
+  // sums the harmonics into every level
+  void buildLevels();
+};
@@ -0,0 +1,185 @@
+// Batch renderer, many scripts rendered in parallel for preset previews and
+// regression corpora. Every job gets its own Renderer (and Patch), the only
+// thing jobs share is the read only Filter and FastSine tables, built once
+// before the workers start (the Filter table is the same at every rate)
+//
+// Job list, one job per line, "#" starts a comment:
+//   <script> [seconds] [output]
+// paths are relative to where batch runs, output is .wav or raw like render
+//
+// usage: batch [-j jobs] [-n threads] [-t seconds] [-r sr] [-b block]
+// threads 0 (default) is one per core
+
+#include "../FastSine.hpp"
+#include "../Filter.hpp"
+#include "Renderer.hpp"
+#include "ThreadPool.hpp"
+#include "WavFile.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Job {
+  std::string script, output;
+  float seconds;
+  // filled in by the worker
+  bool ok;
+  std::string error;
+  Renderer::Stats stats;
+  uint32_t hash;
+  // everything the job did, loading and writing too
+  double jobSeconds;
+};
+
+bool loadJobs(const char *path, float seconds, std::vector<Job> &jobs) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    fprintf(stderr, "can't open %s\n", path);
+    return false;
+  }
+  char line[1024];
+  int lineNumber = 0;
+  while (fgets(line, sizeof(line), file)) {
+    lineNumber++;
+    char *comment = strchr(line, '#');
+    if (comment) {
+      *comment = '\0';
+    }
+    char script[512], output[512];
+    float jobSeconds = seconds;
+    output[0] = '\0';
+    int count = sscanf(line, "%511s %f %511s", script, &jobSeconds, output);
+    if (count < 1) {
+      continue;
+    }
+    if (jobSeconds <= 0.0f) {
+      fprintf(stderr, "%s: line %d: bad length\n", path, lineNumber);
+      fclose(file);
+      return false;
+    }
+    Job job;
+    job.script = script;
+    job.output = output;
+    job.seconds = jobSeconds;
+    job.ok = false;
+    job.hash = 0;
+    job.jobSeconds = 0.0;
+    jobs.push_back(job);
+  }
+  fclose(file);
+  return true;
+}
+
+void runJob(Job &job, float sr, size_t blockSize) {
+  // on the heap, a Patch is too big to keep many on worker stacks
+  std::unique_ptr<Renderer> renderer(new Renderer);
+  renderer->Init(sr, blockSize);
+  if (!renderer->LoadScript(job.script.c_str(), job.error)) {
+    return;
+  }
+  std::vector<float> out;
+  job.stats = renderer->Render(job.seconds, out);
+  job.hash = Renderer::Hash(out);
+  if (!job.output.empty()) {
+    const char *path = job.output.c_str();
+    size_t length = job.output.size();
+    bool wav = length > 4 && strcmp(path + length - 4, ".wav") == 0;
+    bool written = wav ? WriteWav(path, out.data(), job.stats.samples, 2, sr)
+                       : WriteRaw(path, out.data(), out.size());
+    if (!written) {
+      job.error = "can't write " + job.output;
+      return;
+    }
+  }
+  job.ok = true;
+}
+
+int main(int argc, char **argv) {
+  const char *jobsPath = "scripts/batch.txt";
+  size_t threads = 0;
+  float seconds = 20.0f;
+  float sr = 48000.0f;
+  size_t blockSize = 32;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "-j") == 0) {
+      jobsPath = argv[i + 1];
+    } else if (strcmp(argv[i], "-n") == 0) {
+      threads = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-t") == 0) {
+      seconds = atof(argv[i + 1]);
+    } else if (strcmp(argv[i], "-r") == 0) {
+      sr = atof(argv[i + 1]);
+    } else if (strcmp(argv[i], "-b") == 0) {
+      blockSize = atoi(argv[i + 1]);
+    } else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (seconds <= 0.0f || sr <= 0.0f || blockSize == 0) {
+    fprintf(stderr, "seconds, sample rate and block size must be > 0\n");
+    return 1;
+  }
+
+  std::vector<Job> jobs;
+  if (!loadJobs(jobsPath, seconds, jobs)) {
+    return 1;
+  }
+  if (jobs.empty()) {
+    fprintf(stderr, "%s: no jobs\n", jobsPath);
+    return 1;
+  }
+
+  // shared tables, built here so the workers only ever read them
+  Filter::InitLookupTable();
+  FastSine::InitTable();
+
+  ThreadPool pool(threads);
+  auto start = std::chrono::steady_clock::now();
+  for (Job &job : jobs) {
+    // every job writes only to its own Job
+    pool.Submit([&job, sr, blockSize] {
+      auto jobStart = std::chrono::steady_clock::now();
+      runJob(job, sr, blockSize);
+      auto jobEnd = std::chrono::steady_clock::now();
+      job.jobSeconds = std::chrono::duration<double>(jobEnd - jobStart).count();
+    });
+  }
+  pool.Wait();
+  auto end = std::chrono::steady_clock::now();
+  double wallSeconds = std::chrono::duration<double>(end - start).count();
+
+  printf("%zu jobs on %zu threads (%u cores), %.0f Hz, block %zu\n",
+         jobs.size(), pool.GetThreads(), std::thread::hardware_concurrency(),
+         sr, blockSize);
+  printf("%-28s %8s %10s %10s %10s\n", "script", "audio s", "wall ms",
+         "realtime", "hash");
+  size_t samples = 0;
+  double jobSeconds = 0.0;
+  int failed = 0;
+  for (const Job &job : jobs) {
+    jobSeconds += job.jobSeconds;
+    if (!job.ok) {
+      printf("%-28s failed: %s\n", job.script.c_str(), job.error.c_str());
+      failed++;
+      continue;
+    }
+    printf("%-28s %8.1f %10.1f %9.1fx   %08x\n", job.script.c_str(),
+           job.stats.audioSeconds, job.stats.wallSeconds * 1000.0,
+           job.stats.RealtimeFactor(), job.hash);
+    samples += job.stats.samples;
+  }
+  printf("total %zu samples in %.3f s, %.3g samples/s, %.1fx realtime\n",
+         samples, wallSeconds, samples / wallSeconds,
+         samples / sr / wallSeconds);
+  // on an otherwise idle machine this is the speedup over one thread, it
+  // should be close to the number of threads
+  printf("job time %.3f s, %.2fx the wall time, %zu jobs stolen\n",
+         jobSeconds, jobSeconds / wallSeconds, pool.GetSteals());
+  return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,187 @@
+// Bus traffic of DirtyDisplay against full refreshes, with an in-memory
+// display that counts bytes and checks that what it received matches the
+// framebuffer. Screen layout and update rate are the same as Cosmos.cpp
+//
+// usage: displaybench [seconds of UI] [SPI clock in MHz]
+
+#include "../Display.hpp"
+#include "../DirtyDisplay.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// stands in for the SSD1309 and its SPI bus
+class MemoryOled {
+public:
+  // polls a transfer stays busy for, like DMA running in the background
+  static constexpr int busyPolls_ = 2;
+
+  bool Busy() {
+    if (busy_ > 0) {
+      busy_--;
+      return true;
+    }
+    return false;
+  }
+
+  void Send(uint8_t page, uint8_t column, const uint8_t *data, size_t size) {
+    memcpy(&gram_[page][column], data, size);
+    bytes_ += 3 + size;
+    busy_ = busyPolls_;
+  }
+
+  uint8_t gram_[8][128] = {};
+  uint32_t bytes_ = 0;
+
+private:
+  int busy_ = 0;
+};
+
+// same fields as libDaisy's FontDef, glyphs are made up
+struct HostFont {
+  uint8_t FontWidth;
+  uint8_t FontHeight;
+  const uint16_t *data;
+};
+
+uint16_t glyphs[95 * 8];
+const HostFont font = {6, 8, glyphs};
+
+// what FieldWrap does for TextScreen::Render
+struct Target {
+  DirtyDisplay<MemoryOled> &display;
+  void ClearRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height) {
+    display.FillRect(x, y, width, height, false);
+  }
+  void DrawText(uint8_t x, uint8_t y, const char *text, bool color) {
+    display.SetCursor(x, y);
+    display.WriteString(text, font, color);
+  }
+};
+
+int main(int argc, char **argv) {
+  float seconds = argc > 1 ? atof(argv[1]) : 30.0f;
+  float spiMhz = argc > 2 ? atof(argv[2]) : 12.5f;
+  // MAIN_DELAY * DISPLAY_UPDATE_DELAY in Cosmos.cpp
+  const float frameMs = 20.0f;
+  int frames = static_cast<int>(seconds * 1000.0f / frameMs);
+
+  for (int i = 0; i < 95 * 8; i++) {
+    glyphs[i] = static_cast<uint16_t>((i * 2654435761u) >> 16) & 0xFC00;
+  }
+
+  MemoryOled oled;
+  DirtyDisplay<MemoryOled> display;
+  display.Init(&oled);
+  Target target = {display};
+
+  // Cosmos.cpp layout
+  const uint8_t rows[] = {0, 11, 19, 30, 38, 48, 56};
+  TextScreen<32> screen;
+  TextField &bpmField = screen.Add(0, rows[0]);
+  TextField &cpuField = screen.Add(86, rows[0]);
+  TextField &shiftField = screen.Add(0, rows[6]);
+  TextField *noteFields[8];
+  for (int i = 0; i < 8; i++) {
+    noteFields[i] = &screen.Add((i % 4) * 30 + 6, i < 4 ? rows[1] : rows[2]);
+  }
+  const char *names[8] = {"Trns", "????", "????", "????",
+                          "EnvD", "Freq", "Q",    "FilD"};
+  TextField *valueFields[8];
+  for (int i = 0; i < 8; i++) {
+    uint8_t x = (i % 4) * 30 + 6;
+    screen.Add(x, i < 4 ? rows[3] : rows[5]).SetText(names[i]);
+    valueFields[i] = &screen.Add(x, i < 4 ? rows[4] : rows[6]);
+  }
+
+  const char *notes[8] = {"C ", "D#", "F ", "G ", "A#", "C ", "D#", "F "};
+  uint32_t fullBytes = 0;
+  uint32_t sentFrames = 0;
+  int maxPolls = 0;
+  int mismatches = 0;
+  for (int frame = 0; frame < frames; frame++) {
+    float ms = frame * frameMs;
+    // 140 bpm, 8th notes
+    int step = static_cast<int>(ms / (60000.0f / 140.0f / 2.0f)) % 8;
+    // cpu meter moves a little now and then
+    int cpu = 23 + (frame / 37) % 3;
+    // knob sweep on the filter for a couple of seconds every 10
+    bool sweeping = static_cast<int>(ms) % 10000 < 2000;
+    float freq = sweeping ? 200.0f + (static_cast<int>(ms) % 2000) * 5.0f
+                          : 1200.0f;
+    bool shift = static_cast<int>(ms) % 15000 > 13000;
+
+    bpmField.Begin();
+    bpmField.Append("BPM:140x2");
+    bpmField.End();
+    cpuField.Begin();
+    cpuField.Append("CPU:");
+    cpuField.AppendInt(cpu);
+    cpuField.Append("%");
+    cpuField.End();
+    shiftField.SetText(shift ? "Shift 1" : "");
+    for (int i = 0; i < 8; i++) {
+      noteFields[i]->Begin(i % 3 != 0);
+      noteFields[i]->Append(i == step ? "[" : " ");
+      noteFields[i]->Append(notes[i]);
+      noteFields[i]->Append(i == step ? "]" : " ");
+      noteFields[i]->End();
+    }
+    valueFields[0]->Begin();
+    valueFields[0]->AppendInt(0);
+    valueFields[0]->End();
+    valueFields[4]->Begin();
+    valueFields[4]->AppendFloat(0.25f);
+    valueFields[4]->End();
+    valueFields[5]->Begin();
+    valueFields[5]->AppendInt(static_cast<int>(freq));
+    valueFields[5]->End();
+    valueFields[6]->Begin();
+    valueFields[6]->AppendFloat(0.6f);
+    valueFields[6]->End();
+    valueFields[7]->Begin();
+    valueFields[7]->AppendFloat(1.0f);
+    valueFields[7]->End();
+
+    // the old code cleared and sent all 8 pages every frame
+    fullBytes += 8 * (3 + 128);
+    if (screen.Render(target)) {
+      display.Update();
+      sentFrames++;
+    }
+    // main loop iterations until the display is in sync
+    int polls = 0;
+    while (!display.Process()) {
+      polls++;
+    }
+    maxPolls = polls > maxPolls ? polls : maxPolls;
+
+    for (uint8_t page = 0; page < 8; page++) {
+      if (memcmp(oled.gram_[page], display.GetPage(page), 128) != 0) {
+        mismatches++;
+      }
+    }
+  }
+
+  double bitUs = 1.0 / spiMhz;
+  double fullMs = fullBytes * 8 * bitUs / 1000.0;
+  double diffMs = display.GetBytesSent() * 8 * bitUs / 1000.0;
+  printf("%d frames (%.0f ms each), %u redrawn\n", frames, frameMs,
+         sentFrames);
+  printf("%-12s %10s %10s %12s %14s\n", "mode", "bytes", "transfers",
+         "bytes/frame", "bus ms total");
+  printf("%-12s %10u %10d %12.1f %14.2f\n", "full", fullBytes, frames * 8,
+         static_cast<double>(fullBytes) / frames, fullMs);
+  printf("%-12s %10u %10u %12.1f %14.2f\n", "dirty", display.GetBytesSent(),
+         display.GetTransfers(),
+         static_cast<double>(display.GetBytesSent()) / frames, diffMs);
+  printf("bus time %.1f%% of full refresh at %.1f MHz, max %d polls to sync\n",
+         100.0 * diffMs / fullMs, spiMhz, maxPolls);
+  if (mismatches > 0 || oled.bytes_ != display.GetBytesSent()) {
+    printf("ERROR: display doesn't match the framebuffer (%d pages)\n",
+           mismatches);
+    return 1;
+  }
+  printf("display matched the framebuffer after every frame\n");
+  return 0;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/**
+ * Flash in a file, Storage for PresetStore on Linux
+ * Behaves like NOR flash: erased bytes are 0xFF, writes can only clear
+ * bits, so writing over old data without an erase gives garbage like on
+ * the hardware. Every change goes straight to the file
+ * For power loss tests, FailAfter cuts the next write short
+ */
+class FileStorage {
+public:
+  FileStorage() {}
+  ~FileStorage() {
+    if (file_) {
+      fclose(file_);
+    }
+  }
+
+  /**
+   * Opens or creates the file, a new one is all erased
+   *
+   * @param path file to keep the flash in
+   * @param blocks erase blocks, 2 for PresetStore
+   * @param blockSize bytes per erase block, 4096 like the Field's QSPI
+   * @return bool false if the file can't be opened
+   */
+  bool Init(const char *path, size_t blocks = 2, size_t blockSize = 4096) {
+    blockSize_ = blockSize;
+    image_.assign(blocks * blockSize, 0xFF);
+    failAfter_ = -1;
+    file_ = fopen(path, "r+b");
+    if (file_) {
+      // shorter files (or none) are erased flash past the end
+      size_t read = fread(image_.data(), 1, image_.size(), file_);
+      (void)read;
+    } else {
+      file_ = fopen(path, "w+b");
+    }
+    return file_ && flush(0, image_.size());
+  }
+
+  size_t BlockSize() const { return blockSize_; }
+
+  bool Read(size_t offset, uint8_t *data, size_t size) {
+    if (offset + size > image_.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < size; i++) {
+      data[i] = image_[offset + i];
+    }
+    return true;
+  }
+
+  bool Write(size_t offset, const uint8_t *data, size_t size) {
+    if (offset + size > image_.size()) {
+      return false;
+    }
+    bool cut = failAfter_ >= 0 && size_t(failAfter_) < size;
+    size = cut ? size_t(failAfter_) : size;
+    failAfter_ = -1;
+    for (size_t i = 0; i < size; i++) {
+      image_[offset + i] &= data[i];
+    }
+    return flush(offset, size) && !cut;
+  }
+
+  bool Erase(size_t offset) {
+    size_t start = offset / blockSize_ * blockSize_;
+    if (start + blockSize_ > image_.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < blockSize_; i++) {
+      image_[start + i] = 0xFF;
+    }
+    return flush(start, blockSize_);
+  }
+
+  // the next write stops after this many bytes, like a power cut
+  void FailAfter(size_t bytes) { failAfter_ = bytes; }
+
+private:
+  FILE *file_ = nullptr;
+  size_t blockSize_;
+  std::vector<uint8_t> image_;
+  long failAfter_;
+
+  bool flush(size_t offset, size_t size) {
+    return fseek(file_, offset, SEEK_SET) == 0 &&
+           fwrite(image_.data() + offset, 1, size, file_) == size &&
+           fflush(file_) == 0;
+  }
+};
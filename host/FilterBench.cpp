@@ -0,0 +1,166 @@
+// Filter cores, table biquad against the SVF
+// Stereo MultiFilter like the Patch, cutoff swept by an envelope-like
+// signal on every sample. Prints ns/sample (and TSC ticks on x86), memory,
+// how far both are from an exact lowpass at a fixed cutoff and the peak
+// output under very fast modulation at full resonance
+//
+// usage: filterbench [seconds of audio per run]
+
+#include "../Filter.hpp"
+#include "../MultiFilter.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+const float sr = 48000.0f;
+const size_t blockSize = 32;
+
+struct Result {
+  double ns, ticks;
+};
+
+// calls process(bufs, addFreq, size) on every block
+template <typename Process>
+Result run(Process process, const std::vector<float> &in,
+           const std::vector<float> &mod, std::vector<float> &out) {
+  std::vector<float> right(blockSize);
+  size_t size = in.size();
+  out = in;
+  auto start = std::chrono::steady_clock::now();
+#ifdef HAVE_TSC
+  uint64_t startTicks = __rdtsc();
+#endif
+  for (size_t i = 0; i < size; i += blockSize) {
+    size_t n = size - i < blockSize ? size - i : blockSize;
+    for (size_t j = 0; j < n; j++) {
+      right[j] = out[i + j];
+    }
+    float *bufs[2] = {out.data() + i, right.data()};
+    process(bufs, mod.data() + i, n);
+  }
+  Result result;
+#ifdef HAVE_TSC
+  result.ticks = double(__rdtsc() - startTicks) / size;
+#else
+  result.ticks = 0.0;
+#endif
+  auto end = std::chrono::steady_clock::now();
+  result.ns = std::chrono::duration<double, std::nano>(end - start).count() /
+              size;
+  return result;
+}
+
+double peak(const std::vector<float> &buf) {
+  double max = 0.0;
+  for (float x : buf) {
+    max = fabs(x) > max ? fabs(x) : max;
+  }
+  return max;
+}
+
+int main(int argc, char **argv) {
+  float seconds = argc > 1 ? atof(argv[1]) : 10.0f;
+  size_t size = static_cast<size_t>(seconds * sr);
+
+  // noise in, cutoff swept by a decaying envelope every 1/8 s
+  std::vector<float> in(size), mod(size), still(size, 0.0f), out;
+  srand(1);
+  for (size_t i = 0; i < size; i++) {
+    in[i] = 2.0f * rand() / RAND_MAX - 1.0f;
+    float t = (i % (size_t(sr) / 8)) / sr;
+    mod[i] = 0.6f * expf(-t * 20.0f);
+  }
+
+  MultiFilter<2> biquad, svf;
+  biquad.Init(sr, Filter::CORE_BIQUAD);
+  svf.Init(sr, Filter::CORE_SVF);
+  MultiFilter<2> *filters[] = {&biquad, &svf};
+  for (MultiFilter<2> *filter : filters) {
+    filter->SetFreq(0.3f);
+    filter->SetQ(0.5f);
+  }
+
+  printf("MultiFilter<2>, %.0f Hz, block %zu, cutoff moving every sample\n",
+         sr, blockSize);
+  printf("%-22s %10s %10s\n", "core", "ns/sample", "ticks");
+  auto print = [](const char *name, const Result &r) {
+    printf("%-22s %10.2f %10.1f\n", name, r.ns, r.ticks);
+  };
+  // every way of running the filters, same signature as run wants
+  auto biquadRun = [&](float *const *b, const float *m, size_t n) {
+    biquad.ProcessBlock(b, m, n);
+  };
+  auto svfRun = [&](float *const *b, const float *m, size_t n) {
+    svf.ProcessBlock(b, m, n);
+  };
+  std::vector<float> band(blockSize * 2), high(blockSize * 2);
+  float *bands[2] = {band.data(), band.data() + blockSize};
+  float *highs[2] = {high.data(), high.data() + blockSize};
+  auto svfAllRun = [&](float *const *b, const float *m, size_t n) {
+    svf.ProcessBlock(b, m, bands, highs, n);
+  };
+  auto svfFixedRun = [&](float *const *b, const float *m, size_t n) {
+    svf.ProcessBlock(b, n);
+  };
+
+  biquad.SetCoeffMode(Filter::COEFF_NEAREST);
+  print("biquad nearest", run(biquadRun, in, mod, out));
+  biquad.SetCoeffMode(Filter::COEFF_RAMP);
+  print("biquad ramp (block)", run(biquadRun, in, mod, out));
+  print("svf", run(svfRun, in, mod, out));
+  print("svf low+band+high", run(svfAllRun, in, mod, out));
+  print("svf fixed cutoff", run(svfFixedRun, in, mod, out));
+
+  printf("\nmemory, per filter %zu bytes, biquad table %zu bytes shared\n",
+         sizeof(MultiFilter<2>), Filter::GetTableBytes());
+
+  // same cutoff, both against an exact RBJ lowpass in double precision
+  std::vector<float> biquadOut, svfOut;
+  for (MultiFilter<2> *filter : filters) {
+    filter->Init(sr, filter == &svf ? Filter::CORE_SVF : Filter::CORE_BIQUAD);
+    filter->SetCoeffMode(Filter::COEFF_RAMP);
+    filter->SetFreq(0.5f);
+    filter->SetQ(0.5f);
+  }
+  run(biquadRun, in, still, biquadOut);
+  run(svfRun, in, still, svfOut);
+  double w0 = 2.0 * M_PI * biquad.GetFreq() / sr;
+  double alpha = sin(w0) / (2.0 * biquad.GetQ());
+  double b0 = 1.0 + alpha;
+  double a0 = (1.0 - cos(w0)) / 2.0 / b0, a1 = 2.0 * a0;
+  double b1 = -2.0 * cos(w0) / b0, b2 = (1.0 - alpha) / b0;
+  double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+  double biquadError = 0.0, svfError = 0.0;
+  for (size_t i = 0; i < size; i++) {
+    double y = a0 * in[i] + a1 * x1 + a0 * x2 - b1 * y1 - b2 * y2;
+    x2 = x1, x1 = in[i], y2 = y1, y1 = y;
+    biquadError = fmax(biquadError, fabs(biquadOut[i] - y));
+    svfError = fmax(svfError, fabs(svfOut[i] - y));
+  }
+  printf("max error against an exact lowpass at %.0f Hz: biquad %.2e, "
+         "svf %.2e\n",
+         biquad.GetFreq(), biquadError, svfError);
+
+  // full resonance, cutoff jumping across the whole range every sample
+  std::vector<float> jumps(size);
+  for (size_t i = 0; i < size; i++) {
+    jumps[i] = (i & 1) ? 1.0f : 0.0f;
+  }
+  for (MultiFilter<2> *filter : filters) {
+    filter->SetCoeffMode(Filter::COEFF_NEAREST);
+    filter->SetFreq(0.0f);
+    filter->SetQ(1.0f);
+  }
+  run(biquadRun, in, jumps, biquadOut);
+  run(svfRun, in, jumps, svfOut);
+  printf("cutoff jumping 20 Hz <-> 20 kHz every sample, Q 5: peak biquad "
+         "%.3g, svf %.3g\n",
+         peak(biquadOut), peak(svfOut));
+  return 0;
+}
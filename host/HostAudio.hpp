@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Stand-in for the Daisy audio layer on Linux
+ * Calls the audio callback back to back with the same buffer layout as
+ * AudioHandle (one non-interleaved buffer per channel) and times every call
+ */
+class HostAudio {
+public:
+  HostAudio() {}
+  ~HostAudio() {}
+
+  // same layout as daisy::AudioHandle
+  typedef const float *const *InputBuffer;
+  typedef float **OutputBuffer;
+  typedef void (*AudioCallback)(InputBuffer in, OutputBuffer out, size_t size);
+
+  struct Stats {
+    size_t blocks;
+    size_t samples;
+    double totalNs;
+    double worstBlockNs;
+    // audio time rendered, in ns
+    double audioNs;
+
+    double NsPerSample() const { return totalNs / samples; }
+    // how much of the realtime budget the callback uses, in %
+    double BudgetUsage() const { return totalNs / audioNs * 100.0; }
+    // worst block against the duration of one block, in %
+    double WorstBlockUsage() const {
+      return worstBlockNs / (audioNs / blocks) * 100.0;
+    }
+  };
+
+  void Init(float sr, size_t blockSize) {
+    sr_ = sr;
+    blockSize_ = blockSize;
+    for (size_t ch = 0; ch < channels_; ch++) {
+      inBuf_[ch].assign(blockSize_, 0.0f);
+      outBuf_[ch].assign(blockSize_, 0.0f);
+      in_[ch] = inBuf_[ch].data();
+      out_[ch] = outBuf_[ch].data();
+    }
+  }
+
+  float AudioSampleRate() const { return sr_; }
+  size_t AudioBlockSize() const { return blockSize_; }
+
+  /**
+   * Runs the callback until "seconds" of audio have been rendered
+   *
+   * @param cb audio callback
+   * @param seconds audio time to render
+   * @return timing of all the callbacks
+   */
+  Stats Run(AudioCallback cb, float seconds) {
+    Stats stats{};
+    size_t blocks = static_cast<size_t>(seconds * sr_ / blockSize_);
+    for (size_t b = 0; b < blocks; b++) {
+      auto start = std::chrono::steady_clock::now();
+      cb(in_, out_, blockSize_);
+      auto end = std::chrono::steady_clock::now();
+      double ns = std::chrono::duration<double, std::nano>(end - start).count();
+      stats.totalNs += ns;
+      stats.worstBlockNs = ns > stats.worstBlockNs ? ns : stats.worstBlockNs;
+    }
+    stats.blocks = blocks;
+    stats.samples = blocks * blockSize_;
+    stats.audioNs = stats.samples * 1e9 / sr_;
+    return stats;
+  }
+
+  // last rendered block, eg to keep the compiler from dropping the work
+  const float *Output(size_t ch) const { return out_[ch]; }
+
+private:
+  static constexpr size_t channels_ = 2;
+  float sr_;
+  size_t blockSize_;
+  std::vector<float> inBuf_[channels_];
+  std::vector<float> outBuf_[channels_];
+  const float *in_[channels_];
+  float *out_[channels_];
+};
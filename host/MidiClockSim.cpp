@@ -0,0 +1,152 @@
+// MIDI clock following with a synthetic, jittered pulse stream
+// The master's tempo wobbles, pulses arrive late by a random amount and
+// are only seen at the start of an audio block, like on the Field. Clock
+// ticks are compared against the master's real beats, for the clock
+// follower and for the old way (bpm from 24 pulses, free running Clock)
+//
+// usage: midiclocksim [seconds] [bpm] [jitter in ms] [start pulse]
+
+#include "../Clock.hpp"
+#include "../MidiClock.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+const float sr = 48000.0f;
+const size_t blockSize = 32;
+// x2, ticks on 8th notes
+const uint8_t multIndex = 6;
+const float mult = 2.0f;
+
+struct Stats {
+  double sum = 0.0, sumSquares = 0.0, max = 0.0;
+  int count = 0;
+  void Add(double error) {
+    sum += error;
+    sumSquares += error * error;
+    max = fabs(error) > max ? fabs(error) : max;
+    count++;
+  }
+  void Print(const char *name) const {
+    double mean = count ? sum / count : 0.0;
+    double rms = count ? sqrt(sumSquares / count - mean * mean) : 0.0;
+    printf("%-10s %6d %12.3f %12.3f %12.3f\n", name, count, mean, rms, max);
+  }
+};
+
+int main(int argc, char **argv) {
+  float seconds = argc > 1 ? atof(argv[1]) : 60.0f;
+  double bpm = argc > 2 ? atof(argv[2]) : 120.0;
+  double jitterMs = argc > 3 ? atof(argv[3]) : 1.0;
+  // MIDI Start comes just before this pulse, under 12 is while the
+  // follower is still locking
+  int startPulse = argc > 4 ? atoi(argv[4]) : 48;
+
+  // master beats in samples, the tempo wobbles by 0.5% every 16 seconds
+  // and is a bit off from ours, like two crystals
+  std::vector<double> pulseTimes;
+  double t = 0.001 * sr;
+  while (t < seconds * sr) {
+    pulseTimes.push_back(t);
+    double wobble = 1.0 + 0.005 * sin(2.0 * M_PI * t / (16.0 * sr));
+    double samplesPerPulse = 60.0 * sr / (bpm * 1.0003 * wobble) / 24.0;
+    t += samplesPerPulse;
+  }
+  // ideal tick times, beats at the master's pulses (ticks that fall
+  // between pulses are interpolated)
+  auto masterTime = [&](double pulse) {
+    size_t i = static_cast<size_t>(pulse);
+    double frac = pulse - i;
+    return pulseTimes[i] + frac * (pulseTimes[i + 1] - pulseTimes[i]);
+  };
+
+  // arrival in samples, late by a random amount, seen at the next block
+  std::mt19937 rng(1234);
+  std::normal_distribution<double> jitter(0.0, jitterMs * 0.001 * sr);
+  std::vector<uint32_t> arrivals;
+  for (double pulse : pulseTimes) {
+    double late = fabs(jitter(rng));
+    uint32_t seen = static_cast<uint32_t>(ceil((pulse + late) / blockSize));
+    arrivals.push_back(seen * blockSize);
+  }
+
+  MidiClockFollower follower;
+  follower.Init(sr);
+  Clock synced, freeRunning;
+  synced.Init(2, sr);
+  synced.SetMult(multIndex);
+  freeRunning.Init(2, sr);
+  freeRunning.SetMult(multIndex);
+
+  // old way, ms timestamps, bpm every 24 pulses
+  uint32_t prevMs = 0;
+  int packetCount = 0;
+
+  Stats syncedStats, freeStats;
+  int syncedTicks = 0, freeTicks = 0;
+  bool playing = false;
+  size_t next = 0;
+  // skip the first couple of seconds, both need a beat or two to start
+  const double settle = 2.0 * sr;
+  size_t blocks = static_cast<size_t>(seconds * sr) / blockSize - 1000;
+  for (size_t block = 0; block < blocks; block++) {
+    uint32_t now = block * blockSize;
+    // what the callback sees at the start of this block
+    while (next < arrivals.size() && arrivals[next] <= now) {
+      if (static_cast<int>(next) == startPulse) {
+        // Start came just before this pulse
+        follower.Start();
+        synced.SetPhaseToEnd();
+        freeRunning.SetPhaseToEnd();
+        playing = true;
+      }
+      follower.Pulse(now);
+      uint32_t ms = now * 1000 / sr;
+      if (++packetCount >= 24) {
+        if (prevMs > 0) {
+          freeRunning.SetFreq(roundf(60000.0f / (ms - prevMs)) / 60.0f);
+        }
+        prevMs = ms;
+        packetCount = 0;
+      }
+      next++;
+    }
+    if (!playing) {
+      continue;
+    }
+    if (follower.IsLocked()) {
+      synced.Sync(follower.GetBeats(now), follower.GetBeatsPerSample(),
+                  blockSize);
+    }
+    for (size_t i = 0; i < blockSize; i++) {
+      double sample = now + i + 1;
+      if (synced.Process()) {
+        double ideal = masterTime(startPulse + syncedTicks * 24.0 / mult);
+        if (ideal > pulseTimes[startPulse] + settle) {
+          syncedStats.Add((sample - ideal) * 1000.0 / sr);
+        }
+        syncedTicks++;
+      }
+      if (freeRunning.Process()) {
+        double ideal = masterTime(startPulse + freeTicks * 24.0 / mult);
+        if (ideal > pulseTimes[startPulse] + settle) {
+          freeStats.Add((sample - ideal) * 1000.0 / sr);
+        }
+        freeTicks++;
+      }
+    }
+  }
+
+  printf("%.0f s at %.0f bpm, %.1f ms jitter, %zu sample blocks\n", seconds,
+         bpm, jitterMs, blockSize);
+  printf("tick error against the master, ms\n");
+  printf("%-10s %6s %12s %12s %12s\n", "clock", "ticks", "mean", "jitter",
+         "max");
+  syncedStats.Print("follower");
+  freeStats.Print("old");
+  printf("follower: %.2f bpm, pulse drift %.3f ms, pulse jitter %.3f ms\n",
+         follower.GetBpm(), follower.GetDrift(), follower.GetJitter());
+  return 0;
+}
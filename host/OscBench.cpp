@@ -0,0 +1,130 @@
+// Oscillator modes, speed and aliasing
+// Each mode renders a high note that falls exactly on a DFT bin, so every
+// bin that isn't a harmonic is aliasing. Prints ns/sample and the alias
+// power against the harmonics, in dB
+//
+// usage: oscbench [seconds of audio per run]
+
+#include "../Oscillator.hpp"
+#include "../Wavetable.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+const float sr = 48000.0f;
+const size_t blockSize = 32;
+// DFT length, the note is a whole number of bins
+const size_t dftSize = 4096;
+
+double render(Oscillator &osc, float *out, size_t size) {
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < size; i += blockSize) {
+    size_t n = size - i < blockSize ? size - i : blockSize;
+    osc.ProcessBlock(out + i, n);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / size;
+}
+
+// power in the harmonics' bins against everything else, dB
+double aliasDb(const float *in, size_t bin) {
+  std::vector<double> window(dftSize);
+  for (size_t i = 0; i < dftSize; i++) {
+    // Blackman-Harris, alias bins are far below the harmonics
+    double x = 2.0 * M_PI * i / dftSize;
+    window[i] = 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2 * x) -
+                0.01168 * cos(3 * x);
+  }
+  double harmonics = 0.0, alias = 0.0;
+  for (size_t k = 1; k < dftSize / 2; k++) {
+    double re = 0.0, im = 0.0;
+    for (size_t i = 0; i < dftSize; i++) {
+      double x = 2.0 * M_PI * ((k * i) % dftSize) / dftSize;
+      re += in[i] * window[i] * cos(x);
+      im += in[i] * window[i] * sin(x);
+    }
+    double power = re * re + im * im;
+    // the window spreads every line over 4 bins each side
+    size_t distance = k % bin < bin - k % bin ? k % bin : bin - k % bin;
+    if (distance <= 4) {
+      harmonics += power;
+    } else {
+      alias += power;
+    }
+  }
+  return 10.0 * log10(alias / harmonics + 1e-30);
+}
+
+int main(int argc, char **argv) {
+  float seconds = argc > 1 ? atof(argv[1]) : 10.0f;
+  size_t size = static_cast<size_t>(seconds * sr);
+  size = size < dftSize ? dftSize : size;
+  std::vector<float> out(size);
+
+  Wavetable tri, square, saw, loaded;
+  auto start = std::chrono::steady_clock::now();
+  tri.Init(Wavetable::WAVE_TRI);
+  square.Init(Wavetable::WAVE_SQUARE);
+  saw.Init(Wavetable::WAVE_SAW);
+  auto end = std::chrono::steady_clock::now();
+  printf("3 standard waves built in %.2f ms\n",
+         std::chrono::duration<double, std::milli>(end - start).count() / 3);
+
+  // any single cycle, here a naive pulse with a bend
+  std::vector<float> cycle(600);
+  for (size_t i = 0; i < cycle.size(); i++) {
+    float phase = float(i) / cycle.size();
+    cycle[i] = phase < 0.3f ? 1.0f : -0.5f - phase * 0.5f;
+  }
+  start = std::chrono::steady_clock::now();
+  loaded.Load(cycle.data(), cycle.size());
+  end = std::chrono::steady_clock::now();
+  printf("600 sample cycle loaded in %.2f ms\n\n",
+         std::chrono::duration<double, std::milli>(end - start).count());
+
+  struct Run {
+    const char *name;
+    uint8_t mode;
+    const Wavetable *wavetable;
+  };
+  const Run runs[] = {
+      {"sin", Oscillator::MODE_SIN, nullptr},
+      {"tri", Oscillator::MODE_TRI, nullptr},
+      {"saw blep", Oscillator::MODE_SAW, nullptr},
+      {"wt tri", Oscillator::MODE_WT, &tri},
+      {"wt square", Oscillator::MODE_WT, &square},
+      {"wt saw", Oscillator::MODE_WT, &saw},
+      {"wt loaded", Oscillator::MODE_WT, &loaded},
+  };
+  // bins of the notes, about 1.2, 3.5 and 7 kHz
+  const size_t bins[] = {101, 301, 601};
+
+  printf("%-10s %10s", "mode", "ns/sample");
+  for (size_t bin : bins) {
+    printf(" %8.0fHz", bin * sr / dftSize);
+  }
+  printf("\n");
+  for (const Run &run : runs) {
+    Oscillator osc;
+    osc.Init(sr);
+    osc.SetMode(run.mode);
+    osc.SetWavetable(run.wavetable);
+    osc.SetAmp(1.0f);
+    osc.SetFreq(440.0f);
+    double ns = render(osc, out.data(), size);
+    printf("%-10s %10.2f", run.name, ns);
+    for (size_t bin : bins) {
+      osc.Init(sr);
+      osc.SetMode(run.mode);
+      osc.SetWavetable(run.wavetable);
+      osc.SetAmp(1.0f);
+      osc.SetFreq(bin * sr / dftSize);
+      render(osc, out.data(), dftSize);
+      printf(" %8.1fdB", aliasDb(out.data(), bin));
+    }
+    printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,330 @@
+// Preset saving and boot loading, on a file that behaves like the Field's
+// flash. A Patch is edited like the main loop would (knobs, steps, notes),
+// saves go through PresetStore, and the power goes now and then, sometimes
+// in the middle of a write. After every power cut and every few saves a
+// fresh Patch boots from the file and has to come back with the last save
+// that finished. Then cases the random run rarely hits: a save after
+// a record cut short, a write that fails right after a block switch, and
+// the spare block erased ahead while nothing changes.
+// Prints record size, writes, erases and boot load time
+//
+// usage: presetsim [edits] [file]
+
+#include "../Patch.hpp"
+#include "../PresetStore.hpp"
+#include "FileStorage.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+Patch patch;
+
+// same bytes, so the same preset
+bool samePreset(const Preset &a, const Preset &b) {
+  uint8_t bytesA[Preset::maxBytes_], bytesB[Preset::maxBytes_];
+  size_t sizeA = a.Write(bytesA);
+  size_t sizeB = b.Write(bytesB);
+  return sizeA == sizeB && memcmp(bytesA, bytesB, sizeA) == 0;
+}
+
+typedef PresetStore<FileStorage> Store;
+
+// the current preset with step 1 set to note 21 + n, to tell saves apart
+Preset numbered(int n) {
+  Preset preset = patch.GetPreset();
+  preset.notes[0] = static_cast<uint8_t>(21 + n);
+  return preset;
+}
+
+// Save and Process until it's written, false if it never is
+bool saveNow(Store &store, const Preset &preset, uint32_t &now) {
+  store.Save(preset, now);
+  for (int i = 0; i < 4 && store.Pending(); i++) {
+    now += Store::saveDelayMs_;
+    store.Process(now);
+  }
+  return !store.Pending();
+}
+
+// a block with room for exactly 2 records of numbered(n), the record size
+// depends on the edits before
+size_t twoRecordBlock() {
+  uint8_t bytes[Preset::maxBytes_];
+  size_t record = Store::headerBytes_ + numbered(0).Write(bytes);
+  size_t slot = (record + Store::slotBytes_ - 1) / Store::slotBytes_ *
+                Store::slotBytes_;
+  return 2 * slot;
+}
+
+// a fresh store on the file boots into preset n
+bool bootsInto(const char *path, size_t blockSize, int n) {
+  FileStorage storage;
+  Store store;
+  storage.Init(path, 2, blockSize);
+  store.Init(&storage);
+  Preset preset = patch.GetPreset();
+  return store.Load(preset) && samePreset(preset, numbered(n));
+}
+
+// a record cut short keeps its header, the boot falls back to the one
+// before it, and the next save has to win over the broken one
+bool tornThenSaved(const char *path) {
+  const size_t blockSize = twoRecordBlock();
+  uint32_t now = 0;
+  remove(path);
+  {
+    FileStorage storage;
+    Store store;
+    storage.Init(path, 2, blockSize);
+    store.Init(&storage);
+    saveNow(store, numbered(1), now);
+    // the power goes during the write
+    store.Save(numbered(2), now);
+    now += Store::saveDelayMs_;
+    storage.FailAfter(Store::headerBytes_ + 4);
+    store.Process(now);
+  }
+  if (!bootsInto(path, blockSize, 1)) {
+    return false;
+  }
+  FileStorage storage;
+  Store store;
+  storage.Init(path, 2, blockSize);
+  store.Init(&storage);
+  Preset ignored;
+  store.Load(ignored);
+  return saveNow(store, numbered(3), now) && bootsInto(path, blockSize, 3);
+}
+
+// a write fails (no power cut) right after the store moved to the other
+// block, the old block has the only good record and has to stay
+bool failedWriteKeepsGood(const char *path) {
+  const size_t blockSize = twoRecordBlock();
+  uint32_t now = 0;
+  remove(path);
+  FileStorage storage;
+  Store store;
+  storage.Init(path, 2, blockSize);
+  store.Init(&storage);
+  saveNow(store, numbered(1), now);
+  saveNow(store, numbered(2), now);
+  // the erase of the other block, then the write that fails
+  store.Save(numbered(3), now);
+  now += Store::saveDelayMs_;
+  store.Process(now);
+  storage.FailAfter(Store::headerBytes_ + 4);
+  store.Process(now);
+  // a boot in between still finds the last good one
+  if (!bootsInto(path, blockSize, 2)) {
+    return false;
+  }
+  store.Process(now);
+  return !store.Pending() && bootsInto(path, blockSize, 3);
+}
+
+// once nothing changed for a while the spare block is erased ahead, the
+// save that moves to it is only a record write
+bool erasedAhead(const char *path) {
+  const size_t blockSize = twoRecordBlock();
+  uint32_t now = 0;
+  remove(path);
+  FileStorage storage;
+  Store store;
+  storage.Init(path, 2, blockSize);
+  store.Init(&storage);
+  saveNow(store, numbered(1), now);
+  saveNow(store, numbered(2), now);
+  now += Store::idleEraseMs_;
+  bool erased = store.Process(now) && store.GetErases() == 1;
+  store.Save(numbered(3), now);
+  now += Store::saveDelayMs_;
+  store.Process(now);
+  return erased && !store.Pending() && store.GetErases() == 1 &&
+         bootsInto(path, blockSize, 3);
+}
+
+// a knob, key or note change, only values the UI can send
+void randomEdit(std::mt19937 &rng) {
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  auto pick = [&rng](int count) { return int(rng() % count); };
+  switch (pick(10)) {
+  case 0:
+    patch.SetParam(Patch::PARAM_FILTER_FREQ, unit(rng));
+    break;
+  case 1:
+    patch.SetParam(Patch::PARAM_FILTER_Q, unit(rng));
+    break;
+  case 2:
+    patch.SetParam(Patch::PARAM_ENV1_ATTACK + pick(5), 0.5f * unit(rng));
+    break;
+  case 3:
+    patch.SetParam(Patch::PARAM_NOTE + pick(Patch::steps_), 21 + pick(88));
+    break;
+  case 4:
+    patch.SetParam(Patch::PARAM_SEQ1_TOGGLE, pick(Patch::steps_));
+    break;
+  case 5:
+    patch.SetParam(Patch::PARAM_SEQ2_TOGGLE, pick(Patch::steps_));
+    break;
+  case 6:
+    patch.SetParam(Patch::PARAM_TRANSPOSE, pick(49) - 24);
+    break;
+  case 7:
+    patch.SetParam(Patch::PARAM_CLOCK_FREQ, (20 + pick(201)) / 60.0f);
+    patch.SetParam(Patch::PARAM_CLOCK_MULT, pick(11));
+    break;
+  case 8:
+    patch.SetParam(Patch::PARAM_OVERSAMPLE, pick(Patch::OVERSAMPLE_LAST));
+    patch.SetParam(Patch::PARAM_FILTER_CORE, pick(Filter::CORE_LAST));
+    patch.SetParam(Patch::PARAM_CONTROL_INTERVAL, 1 << pick(7));
+    break;
+  case 9: {
+    // track length, direction, divider, rotate or fill
+    uint8_t track = pick(Patch::TRACK_LAST);
+    switch (pick(5)) {
+    case 0:
+      patch.SetParam(Patch::PARAM_LENGTH + track, 1 + pick(64));
+      break;
+    case 1:
+      patch.SetParam(Patch::PARAM_DIRECTION + track,
+                     pick(StepCounter::DIR_LAST));
+      break;
+    case 2:
+      patch.SetParam(Patch::PARAM_DIVIDER + track, 1 + pick(16));
+      break;
+    case 3:
+      patch.SetParam(Patch::PARAM_ROTATE + track, pick(17) - 8);
+      break;
+    case 4:
+      patch.SetParam(Patch::PARAM_FILL + track, pick(17));
+      break;
+    }
+    break;
+  }
+  }
+}
+
+int main(int argc, char **argv) {
+  int edits = argc > 1 ? atoi(argv[1]) : 5000;
+  const char *path = argc > 2 ? argv[2] : "build/presets.bin";
+  const float sr = 48000.0f;
+  float out[32];
+  remove(path);
+
+  FileStorage storage;
+  if (!storage.Init(path)) {
+    fprintf(stderr, "%s: can't open\n", path);
+    return 1;
+  }
+  PresetStore<FileStorage> store;
+  store.Init(&storage);
+  patch.Init(sr);
+
+  std::mt19937 rng(1);
+  // the last save that finished, what a boot has to find
+  Preset saved = patch.GetPreset();
+  bool anySaved = false;
+  uint32_t changes = patch.GetPresetChanges();
+  uint32_t now = 0;
+  int cuts = 0, boots = 0, failedBoots = 0;
+  uint32_t writes = 0, erases = 0;
+  double bootUs = 0.0, worstBootUs = 0.0;
+
+  // power on, everything from the file, like main() in Cosmos.cpp
+  auto boot = [&]() {
+    FileStorage bootStorage;
+    bootStorage.Init(path);
+    PresetStore<FileStorage> bootStore;
+    patch.Init(sr);
+    // defaults for whatever isn't saved
+    Preset preset = patch.GetPreset();
+    // Init is the same with or without presets, this is what's added
+    auto start = std::chrono::steady_clock::now();
+    bootStore.Init(&bootStorage);
+    bool found = bootStore.Load(preset);
+    patch.LoadPreset(preset);
+    auto end = std::chrono::steady_clock::now();
+    double us = std::chrono::duration<double, std::micro>(end - start).count();
+    bootUs += us;
+    worstBootUs = us > worstBootUs ? us : worstBootUs;
+    boots++;
+    // the modules took it as it was, eg same clamping as the copy
+    if (found != anySaved || (anySaved && !samePreset(preset, saved)) ||
+        (anySaved && !samePreset(patch.GetPreset(), saved))) {
+      failedBoots++;
+    }
+    // the store and its file go on from what the boot found
+    writes += store.GetWrites();
+    erases += store.GetErases();
+    storage.Init(path);
+    store.Init(&storage);
+    Preset ignored;
+    store.Load(ignored);
+    changes = patch.GetPresetChanges();
+  };
+
+  for (int edit = 0; edit < edits; edit++) {
+    randomEdit(rng);
+    // the audio callback applies it
+    patch.Process(out, out, 32);
+    // main loop, 5 ms per iteration until the next edit
+    uint32_t next = now + 100 + rng() % 4000;
+    for (; now < next; now += 5) {
+      if (patch.GetPresetChanges() != changes) {
+        changes = patch.GetPresetChanges();
+        store.Save(patch.GetPreset(), now);
+      }
+      bool pending = store.Pending();
+      if (pending && rng() % 4000 == 0) {
+        // the power goes during whatever Process does next
+        storage.FailAfter(rng() % 40);
+        store.Process(now);
+        cuts++;
+        boot();
+        continue;
+      }
+      store.Process(now);
+      if (pending && !store.Pending()) {
+        saved = patch.GetPreset();
+        anySaved = true;
+        if (rng() % 8 == 0) {
+          boot();
+        }
+      }
+    }
+  }
+  boot();
+
+  // a version 1 record, without the track fields (one byte each), reads
+  // with defaults for them
+  uint8_t bytes[Preset::maxBytes_];
+  Preset full = patch.GetPreset();
+  size_t size = full.Write(bytes);
+  Preset old = full;
+  old.lengths[0] = 99;
+  bool oldOk = old.Read(bytes, size - 3 * Preset::tracks_, 1) &&
+               old.lengths[0] == 99 &&
+               old.controlInterval == full.controlInterval;
+
+  bool tornOk = tornThenSaved(path);
+  bool failedOk = failedWriteKeepsGood(path);
+  bool aheadOk = erasedAhead(path);
+
+  printf("%d edits, %u records written, %u erases, %d power cuts\n", edits,
+         writes, erases, cuts);
+  printf("record %zu bytes (payload %zu), %d boots, %d wrong\n",
+         store.GetStoredBytes(), size, boots, failedBoots);
+  printf("boot load %.1f us average, %.1f us worst\n", bootUs / boots,
+         worstBootUs);
+  printf("shorter record from an older version reads: %s\n",
+         oldOk ? "yes" : "no");
+  printf("save after a record cut short boots into the save: %s\n",
+         tornOk ? "yes" : "no");
+  printf("failed write keeps the last good record: %s\n",
+         failedOk ? "yes" : "no");
+  printf("spare block erased while idle, the next save is one write: %s\n",
+         aheadOk ? "yes" : "no");
+  return failedBoots == 0 && oldOk && tornOk && failedOk && aheadOk ? 0 : 1;
+}
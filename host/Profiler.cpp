@@ -0,0 +1,105 @@
+// Host CPU budget profiler
+// Runs the same Patch as AudioCallback in Cosmos.cpp on a stub audio layer,
+// at different block sizes, sample rates and oversampling qualities, at
+// different control rates (see ControlRate), then through the firmware's
+// audio profiles switched at runtime, like FieldWrap::SetAudioProfile does
+// (Patch::SetSampleRate, no Init)
+//
+// usage: profiler [seconds of audio per run]
+
+#include "../AudioProfile.hpp"
+#include "../Patch.hpp"
+#include "HostAudio.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+Patch patch;
+
+// AudioCallback from Cosmos.cpp without the hardware (MIDI, LEDs, CPU meter)
+void AudioCallback(HostAudio::InputBuffer in, HostAudio::OutputBuffer out,
+                   size_t size) {
+  patch.Process(out[0], out[1], size);
+}
+
+// busy patch, every step triggers and both envelopes are always running
+void SetupPatch(float sr, uint8_t oversample) {
+  patch.Init(sr);
+  patch.SetParam(Patch::PARAM_OVERSAMPLE, oversample);
+  for (uint8_t i = 0; i < 8; i++) {
+    patch.seq1.ToggleStep(i);
+    patch.pitchSeq.SetNote(i, 36 + i * 5);
+  }
+  patch.clock.SetFreq(140.0f / 60.0f);
+  patch.clock.SetMult(7); // x3
+  patch.env1.SetAttack(0.005f);
+  patch.env1.SetDecay(0.2f);
+  patch.env2.SetAttack(0.01f);
+  patch.env2.SetDecay(0.3f);
+  patch.env2.SetScale(0.6f);
+  patch.filter.SetFreq(0.3f);
+  patch.filter.SetQ(0.6f);
+  patch.ResetAllSeqs();
+  patch.play = true;
+}
+
+int main(int argc, char **argv) {
+  float seconds = argc > 1 ? atof(argv[1]) : 10.0f;
+  const float sampleRates[] = {48000.0f, 96000.0f};
+  const size_t blockSizes[] = {1, 8, 32, 128};
+  const char *oversampleNames[] = {"off", "fast", "best"};
+
+  printf("%8s %6s %5s %10s %10s %10s %12s %10s\n", "sr", "block", "os",
+         "ns/sample", "us/block", "budget %", "worst us", "worst %");
+  for (float sr : sampleRates) {
+    for (size_t blockSize : blockSizes) {
+      for (uint8_t os = 0; os < Patch::OVERSAMPLE_LAST; os++) {
+        HostAudio audio;
+        audio.Init(sr, blockSize);
+        SetupPatch(sr, os);
+        HostAudio::Stats stats = audio.Run(AudioCallback, seconds);
+        printf("%8.0f %6zu %5s %10.2f %10.3f %10.3f %12.2f %10.2f\n", sr,
+               blockSize, oversampleNames[os], stats.NsPerSample(),
+               stats.NsPerSample() * blockSize / 1000.0, stats.BudgetUsage(),
+               stats.worstBlockNs / 1000.0, stats.WorstBlockUsage());
+      }
+    }
+  }
+
+  // modulation cost, env2 updated every "interval" samples
+  printf("\n%8s %10s %10s\n", "interval", "ns/sample", "budget %");
+  const size_t intervals[] = {1, 4, 16, 64};
+  for (size_t interval : intervals) {
+    HostAudio audio;
+    audio.Init(48000.0f, 32);
+    SetupPatch(48000.0f, Patch::OVERSAMPLE_OFF);
+    patch.SetParam(Patch::PARAM_CONTROL_INTERVAL, interval);
+    HostAudio::Stats stats = audio.Run(AudioCallback, seconds);
+    printf("%8zu %10.2f %10.3f\n", interval, stats.NsPerSample(),
+           stats.BudgetUsage());
+  }
+
+  // one patch for every profile, only the rate changes between them
+  printf("\n%8s %9s %10s %10s %10s %16s\n", "profile", "block ms",
+         "ns/sample", "budget %", "worst %", "SetSampleRate ns");
+  SetupPatch(48000.0f, Patch::OVERSAMPLE_OFF);
+  for (uint8_t i = 0; i < AudioProfile::PROFILE_LAST; i++) {
+    const AudioProfile &profile = AudioProfile::Get(i);
+    const int reps = 1000;
+    auto start = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < reps; rep++) {
+      // alternate, so every call changes something
+      patch.SetSampleRate(rep & 1 ? 44100.0f : profile.sampleRate);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double switchNs =
+        std::chrono::duration<double, std::nano>(end - start).count() / reps;
+    HostAudio audio;
+    audio.Init(profile.sampleRate, profile.blockSize);
+    HostAudio::Stats stats = audio.Run(AudioCallback, seconds);
+    printf("%8s %9.3f %10.2f %10.3f %10.2f %16.1f\n", profile.name,
+           profile.BlockMs(), stats.NsPerSample(), stats.BudgetUsage(),
+           stats.WorstBlockUsage(), switchNs);
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+// Offline renderer, the Cosmos Patch driven by a script instead of knobs
+// Writes a 32 bit float WAV (.wav) or raw interleaved floats (anything else)
+// and prints the realtime factor and a hash of the output for regressions
+//
+// usage: render [-s script] [-o output] [-t seconds] [-r sr] [-b block]
+// with no script, host/scripts/demo.txt is used
+
+#include "Renderer.hpp"
+#include "WavFile.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+  const char *scriptPath = "scripts/demo.txt";
+  const char *outPath = nullptr;
+  float seconds = 20.0f;
+  float sr = 48000.0f;
+  size_t blockSize = 32;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "-s") == 0) {
+      scriptPath = argv[i + 1];
+    } else if (strcmp(argv[i], "-o") == 0) {
+      outPath = argv[i + 1];
+    } else if (strcmp(argv[i], "-t") == 0) {
+      seconds = atof(argv[i + 1]);
+    } else if (strcmp(argv[i], "-r") == 0) {
+      sr = atof(argv[i + 1]);
+    } else if (strcmp(argv[i], "-b") == 0) {
+      blockSize = atoi(argv[i + 1]);
+    } else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (seconds <= 0.0f || sr <= 0.0f || blockSize == 0) {
+    fprintf(stderr, "seconds, sample rate and block size must be > 0\n");
+    return 1;
+  }
+
+  Renderer renderer;
+  renderer.Init(sr, blockSize);
+  std::string error;
+  if (!renderer.LoadScript(scriptPath, error)) {
+    fprintf(stderr, "%s: %s\n", scriptPath, error.c_str());
+    return 1;
+  }
+
+  std::vector<float> out;
+  Renderer::Stats stats = renderer.Render(seconds, out);
+  printf("%s: %zu events, %.1f s at %.0f Hz, block %zu\n", scriptPath,
+         renderer.GetEvents().size(), stats.audioSeconds, sr, blockSize);
+  printf("rendered in %.3f s, %.1fx realtime, %.2f ns/sample\n",
+         stats.wallSeconds, stats.RealtimeFactor(),
+         stats.wallSeconds * 1e9 / stats.samples);
+  printf("hash %08x\n", Renderer::Hash(out));
+
+  if (outPath) {
+    size_t length = strlen(outPath);
+    bool wav = length > 4 && strcmp(outPath + length - 4, ".wav") == 0;
+    bool ok = wav ? WriteWav(outPath, out.data(), stats.samples, 2, sr)
+                  : WriteRaw(outPath, out.data(), out.size());
+    if (!ok) {
+      fprintf(stderr, "can't write %s\n", outPath);
+      return 1;
+    }
+    printf("wrote %s\n", outPath);
+  }
+  return 0;
+}
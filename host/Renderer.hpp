@@ -0,0 +1,238 @@
+#pragma once
+
+#include "../Patch.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * Renders the Cosmos Patch offline, as fast as it goes
+ * Changes come from a script and go through Patch::SetParam like the main
+ * loop's, so they land on block boundaries exactly like on the Field
+ *
+ * Script, one change per line, "#" starts a comment:
+ *   <seconds> <name> <value>
+ *   <seconds> note <step> <midi note>
+ *   <seconds> seq1 <step>   (toggles, same for seq2)
+ *   <seconds> play <1 or 0>
+ *   <seconds> oversample <0 off, 1 fast, 2 best>
+ *   <seconds> filter_core <0 biquad, 1 svf>
+ *   <seconds> control_interval <samples between env2 updates, 1 to 256>
+ *   <seconds> length <track> <steps>
+ *   <seconds> direction <track> <0 forward, 1 backward, 2 pingpong>
+ *   <seconds> divider <track> <clock ticks per step>
+ *   <seconds> rotate <track> <steps, negative is earlier>
+ *   <seconds> fill <track> <Euclidean hits>
+ * tracks are 0 seq1, 1 seq2, 2 pitch
+ * names are the Patch params in lowercase without PARAM_, eg filter_freq,
+ * plus bpm (clock_freq in beats per minute)
+ */
+class Renderer {
+public:
+  Renderer() {}
+  ~Renderer() {}
+
+  struct Event {
+    double time;
+    uint8_t param;
+    float value;
+  };
+
+  struct Stats {
+    size_t samples;
+    double audioSeconds;
+    double wallSeconds;
+
+    // how many times faster than realtime
+    double RealtimeFactor() const { return audioSeconds / wallSeconds; }
+  };
+
+  /**
+   * @param sr sample rate
+   * @param blockSize samples per Process call, like the audio callback
+   */
+  void Init(float sr, size_t blockSize) {
+    sr_ = sr;
+    blockSize_ = blockSize;
+    patch_.Init(sr);
+  }
+
+  /**
+   * Reads a script, adds to what's already there
+   *
+   * @param error what went wrong, with the line number
+   * @return bool false if the script has errors
+   */
+  bool ParseScript(const std::string &text, std::string &error) {
+    size_t lineNumber = 0;
+    size_t start = 0;
+    while (start < text.size()) {
+      size_t end = text.find('\n', start);
+      end = end == std::string::npos ? text.size() : end;
+      std::string line = text.substr(start, end - start);
+      start = end + 1;
+      lineNumber++;
+      // comments and empty lines
+      line = line.substr(0, line.find('#'));
+      if (line.find_first_not_of(" \t\r") == std::string::npos) {
+        continue;
+      }
+      if (!parseLine(line.c_str())) {
+        error = "line " + std::to_string(lineNumber) + ": " + line;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool LoadScript(const char *path, std::string &error) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+      error = std::string("can't open ") + path;
+      return false;
+    }
+    std::string text;
+    char buf[4096];
+    size_t read;
+    while ((read = fread(buf, 1, sizeof(buf), file)) > 0) {
+      text.append(buf, read);
+    }
+    fclose(file);
+    return ParseScript(text, error);
+  }
+
+  /**
+   * @param seconds audio to render
+   * @param out interleaved stereo, resized to fit
+   */
+  Stats Render(float seconds, std::vector<float> &out) {
+    size_t frames = static_cast<size_t>(seconds * sr_);
+    out.assign(frames * 2, 0.0f);
+    std::vector<float> left(blockSize_), right(blockSize_);
+    size_t next = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t frame = 0; frame < frames; frame += blockSize_) {
+      size_t size = frames - frame < blockSize_ ? frames - frame : blockSize_;
+      // everything due by the start of this block, a full queue waits
+      // for the next one like on the Field
+      while (next < events_.size() && events_[next].time * sr_ <= frame &&
+             patch_.SetParam(events_[next].param, events_[next].value)) {
+        next++;
+      }
+      patch_.Process(left.data(), right.data(), size);
+      for (size_t i = 0; i < size; i++) {
+        out[(frame + i) * 2] = left[i];
+        out[(frame + i) * 2 + 1] = right[i];
+      }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    Stats stats;
+    stats.samples = frames;
+    stats.audioSeconds = frames / sr_;
+    stats.wallSeconds = std::chrono::duration<double>(end - start).count();
+    return stats;
+  }
+
+  // FNV-1a of the samples, for comparing renders
+  static uint32_t Hash(const std::vector<float> &samples) {
+    uint32_t hash = 2166136261u;
+    for (float sample : samples) {
+      uint32_t bits;
+      memcpy(&bits, &sample, sizeof(bits));
+      for (int i = 0; i < 4; i++) {
+        hash = (hash ^ ((bits >> (i * 8)) & 0xFF)) * 16777619u;
+      }
+    }
+    return hash;
+  }
+
+  const std::vector<Event> &GetEvents() const { return events_; }
+
+private:
+  float sr_;
+  size_t blockSize_;
+  Patch patch_;
+  std::vector<Event> events_;
+
+  struct Name {
+    const char *name;
+    uint8_t param;
+  };
+
+  bool parseLine(const char *line) {
+    double time;
+    char name[32];
+    float a, b;
+    int count = sscanf(line, "%lf %31s %f %f", &time, name, &a, &b);
+    if (count < 3 || time < 0.0) {
+      return false;
+    }
+    static const Name names[] = {
+        {"clock_freq", Patch::PARAM_CLOCK_FREQ},
+        {"clock_mult", Patch::PARAM_CLOCK_MULT},
+        {"transpose", Patch::PARAM_TRANSPOSE},
+        {"env1_attack", Patch::PARAM_ENV1_ATTACK},
+        {"env1_decay", Patch::PARAM_ENV1_DECAY},
+        {"env2_attack", Patch::PARAM_ENV2_ATTACK},
+        {"env2_decay", Patch::PARAM_ENV2_DECAY},
+        {"env2_scale", Patch::PARAM_ENV2_SCALE},
+        {"filter_freq", Patch::PARAM_FILTER_FREQ},
+        {"filter_q", Patch::PARAM_FILTER_Q},
+        {"play", Patch::PARAM_PLAY},
+        {"seq1", Patch::PARAM_SEQ1_TOGGLE},
+        {"seq2", Patch::PARAM_SEQ2_TOGGLE},
+        {"oversample", Patch::PARAM_OVERSAMPLE},
+        {"filter_core", Patch::PARAM_FILTER_CORE},
+        {"control_interval", Patch::PARAM_CONTROL_INTERVAL},
+    };
+    // first track's param, + track
+    static const Name trackNames[] = {
+        {"length", Patch::PARAM_LENGTH},
+        {"direction", Patch::PARAM_DIRECTION},
+        {"divider", Patch::PARAM_DIVIDER},
+        {"rotate", Patch::PARAM_ROTATE},
+        {"fill", Patch::PARAM_FILL},
+    };
+    Event event = {time, Patch::PARAM_LAST, a};
+    if (strcmp(name, "bpm") == 0) {
+      event.param = Patch::PARAM_CLOCK_FREQ;
+      event.value = a / 60.0f;
+    } else if (strcmp(name, "note") == 0) {
+      if (count < 4 || a < 0 || a >= Patch::steps_) {
+        return false;
+      }
+      event.param = Patch::PARAM_NOTE + static_cast<uint8_t>(a);
+      event.value = b;
+    } else {
+      for (const Name &n : names) {
+        if (strcmp(name, n.name) == 0) {
+          event.param = n.param;
+        }
+      }
+      for (const Name &n : trackNames) {
+        if (strcmp(name, n.name) == 0) {
+          if (count < 4 || a < 0 || a >= Patch::TRACK_LAST) {
+            return false;
+          }
+          event.param = n.param + static_cast<uint8_t>(a);
+          event.value = b;
+        }
+      }
+    }
+    if (event.param == Patch::PARAM_LAST) {
+      return false;
+    }
+    // in time order, same times stay in script order
+    size_t i = events_.size();
+    while (i > 0 && events_[i - 1].time > time) {
+      i--;
+    }
+    events_.insert(events_.begin() + i, event);
+    return true;
+  }
+};
@@ -0,0 +1,168 @@
+// Sequencer tracks, cost per clock tick against the number of tracks, each
+// with its own length, direction, divider and Euclidean fill. Also checks
+// the precomputed Euclidean patterns against Bjorklund's algorithm and
+// known rhythms (up to rotation) and rotation itself, and prints ns per
+// fill from the table and from Bjorklund's algorithm
+//
+// usage: seqbench [million ticks]
+
+#include "../TriggerSequencer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+typedef std::vector<std::vector<bool>> Groups;
+
+// Bjorklund's algorithm the usual way, written apart from TriggerSequencer
+// to check it: groups from the back are paired with groups from the front
+// until at most one is left over. Bit n is step n, eg E(3, 8) is x..x..x.
+uint64_t Bjorklund(uint8_t hits, uint8_t length) {
+  Groups front(hits, std::vector<bool>(1, true));
+  Groups back(length - hits, std::vector<bool>(1, false));
+  while (back.size() > 1 && !front.empty()) {
+    size_t pairs = std::min(front.size(), back.size());
+    // what's left of the longer list is the new back
+    Groups rest = front.size() > pairs
+                      ? Groups(front.begin() + pairs, front.end())
+                      : Groups(back.begin() + pairs, back.end());
+    front.resize(pairs);
+    for (size_t i = 0; i < pairs; i++) {
+      front[i].insert(front[i].end(), back[i].begin(), back[i].end());
+    }
+    back = rest;
+  }
+  uint64_t pattern = 0;
+  size_t step = 0;
+  for (const Groups *groups : {&front, &back}) {
+    for (const std::vector<bool> &group : *groups) {
+      for (bool hit : group) {
+        pattern |= uint64_t(hit) << step++;
+      }
+    }
+  }
+  return pattern;
+}
+
+// eg "x..x..x." to bit n is step n
+uint64_t Parse(const char *steps) {
+  uint64_t pattern = 0;
+  for (int i = 0; steps[i]; i++) {
+    pattern |= uint64_t(steps[i] == 'x') << i;
+  }
+  return pattern;
+}
+
+bool SameUpToRotation(uint64_t a, uint64_t b, uint8_t length) {
+  for (int shift = 0; shift < length; shift++) {
+    if (TriggerSequencer::RotateSequence(b, length, shift) == a) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  double millions = argc > 1 ? atof(argv[1]) : 10.0;
+  size_t ticks = static_cast<size_t>(millions * 1e6);
+  int errors = 0;
+
+  // every pattern has its hits, starts on one and rotates back in place
+  for (uint8_t length = 1; length <= TriggerSequencer::maxSteps_; length++) {
+    for (uint8_t hits = 0; hits <= length; hits++) {
+      uint64_t pattern = TriggerSequencer::Euclid(hits, length);
+      uint64_t rotated =
+          TriggerSequencer::RotateSequence(pattern, length, length + 3);
+      rotated = TriggerSequencer::RotateSequence(rotated, length, -3);
+      if (!SameUpToRotation(pattern, Bjorklund(hits, length), length) ||
+          __builtin_popcountll(pattern) != hits ||
+          (hits > 0 && !(pattern & 1)) || rotated != pattern) {
+        printf("wrong pattern: %d hits over %d steps\n", hits, length);
+        errors++;
+      }
+    }
+  }
+
+  // from Toussaint, "The Euclidean algorithm generates traditional musical
+  // rhythms"
+  struct Known {
+    uint8_t hits;
+    const char *steps;
+  };
+  const Known known[] = {{2, "x.x.."},
+                         {3, "x.xx"},
+                         {3, "x..x..x."},
+                         {4, "x.x.x.x.."},
+                         {5, "x.xx.xx."},
+                         {5, "x..x.x..x.x."},
+                         {5, "x..x..x..x..x..."},
+                         {7, "x..x.x.x..x.x.x."}};
+  for (const Known &rhythm : known) {
+    uint8_t length = strlen(rhythm.steps);
+    if (!SameUpToRotation(TriggerSequencer::Euclid(rhythm.hits, length),
+                          Parse(rhythm.steps), length) ||
+        !SameUpToRotation(Bjorklund(rhythm.hits, length),
+                          Parse(rhythm.steps), length)) {
+      printf("wrong pattern: E(%d, %d) isn't %s\n", rhythm.hits, length,
+             rhythm.steps);
+      errors++;
+    }
+  }
+
+  std::mt19937 rng(1);
+  auto pick = [&rng](int count) { return int(rng() % count); };
+  printf("%-8s %12s %14s %10s\n", "tracks", "ns/tick", "ns/track/tick",
+         "triggers");
+  const int trackCounts[] = {3, 16, 32, 64};
+  for (int count : trackCounts) {
+    std::vector<TriggerSequencer> tracks(count);
+    for (TriggerSequencer &track : tracks) {
+      uint8_t length = 1 + pick(TriggerSequencer::maxSteps_);
+      track.Init(length);
+      track.SetDirection(pick(StepCounter::DIR_LAST));
+      track.SetDivider(1 + pick(4));
+      track.Fill(pick(length + 1));
+      track.Rotate(pick(length));
+    }
+    // counted so the loop isn't optimized away
+    size_t triggers = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t tick = 0; tick < ticks; tick++) {
+      for (TriggerSequencer &track : tracks) {
+        triggers += track.Advance() && track.IsCurrentStepActive();
+      }
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns =
+        std::chrono::duration<double, std::nano>(end - start).count() / ticks;
+    printf("%-8d %12.2f %14.2f %10zu\n", count, ns, ns / count, triggers);
+  }
+
+  // fills, every hits and length pair in turn
+  size_t fills = ticks / 10;
+  uint64_t sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < fills; i++) {
+    uint8_t length = 1 + i % 32;
+    sum += TriggerSequencer::Euclid(i % (length + 1), length);
+  }
+  auto mid = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < fills; i++) {
+    uint8_t length = 1 + i % 32;
+    sum += Bjorklund(i % (length + 1), length);
+  }
+  auto end = std::chrono::steady_clock::now();
+  double tableNs =
+      std::chrono::duration<double, std::nano>(mid - start).count() / fills;
+  double slowNs =
+      std::chrono::duration<double, std::nano>(end - mid).count() / fills;
+  // the sum is printed so the loops aren't optimized away
+  printf("fill up to 32 steps: %.2f ns from the table, %.2f ns with "
+         "Bjorklund's algorithm (%x)\n",
+         tableNs, slowNs, static_cast<unsigned>(sum & 0xFFFF));
+  printf("%d wrong patterns\n", errors);
+  return errors == 0 ? 0 : 1;
+}
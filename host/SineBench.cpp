@@ -0,0 +1,89 @@
+// Microbenchmark for the FastSine engines against sinf
+// Prints max error against double precision sin() and ns/sample
+//
+// usage: sinebench [seconds of audio per run]
+
+#include "../FastSine.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+const float sr = 48000.0f;
+
+// renders like Oscillator MODE_SIN, phase from 0 to 1
+template <typename SineFn>
+double Render(SineFn sine, float freq, float *out, size_t size) {
+  float phase = 0.0f;
+  float phaseInc = freq / sr;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < size; i++) {
+    out[i] = sine(phase);
+    phase += phaseInc;
+    if (phase > 1.0f) {
+      phase -= 1.0f;
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / size;
+}
+
+// max error over the rendered buffer, against sin() of the same phases
+double MaxError(const float *out, float freq, size_t size) {
+  float phase = 0.0f;
+  float phaseInc = freq / sr;
+  double maxError = 0.0;
+  for (size_t i = 0; i < size; i++) {
+    double error = fabs(out[i] - sin(2.0 * M_PI * phase));
+    maxError = error > maxError ? error : maxError;
+    phase += phaseInc;
+    if (phase > 1.0f) {
+      phase -= 1.0f;
+    }
+  }
+  return maxError;
+}
+
+int main(int argc, char **argv) {
+  float seconds = argc > 1 ? atof(argv[1]) : 10.0f;
+  size_t size = static_cast<size_t>(seconds * sr);
+  std::vector<float> out(size);
+  // a few frequencies, so the resonator goes through SetPhaseInc too
+  const float freqs[] = {27.5f, 440.0f, 4186.0f};
+
+  FastSine::InitTable();
+  FastSine resonator;
+  resonator.Init();
+
+  printf("%-10s %10s %12s\n", "engine", "ns/sample", "max error");
+  for (int engine = -1; engine < FastSine::ENGINE_LAST; engine++) {
+    double ns = 0.0;
+    double maxError = 0.0;
+    for (float freq : freqs) {
+      double runNs = 0.0;
+      switch (engine) {
+      case FastSine::ENGINE_TABLE:
+        runNs = Render(FastSine::Table, freq, out.data(), size);
+        break;
+      case FastSine::ENGINE_POLY:
+        runNs = Render(FastSine::Poly, freq, out.data(), size);
+        break;
+      case FastSine::ENGINE_RESONATOR:
+        resonator.SetPhaseInc(freq / sr);
+        runNs = Render([&](float phase) { return resonator.Resonator(phase); },
+                       freq, out.data(), size);
+        break;
+      default:
+        runNs = Render([](float phase) { return sinf(phase * TWOPI_F); },
+                       freq, out.data(), size);
+        break;
+      }
+      double error = MaxError(out.data(), freq, size);
+      ns += runNs / (sizeof(freqs) / sizeof(freqs[0]));
+      maxError = error > maxError ? error : maxError;
+    }
+    const char *names[] = {"sinf", "table", "poly", "resonator"};
+    printf("%-10s %10.2f %12.3g\n", names[engine + 1], ns, maxError);
+  }
+  return 0;
+}
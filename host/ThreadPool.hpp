@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Work stealing thread pool for the host tools
+ * Every worker has its own queue, jobs are spread over the queues as they
+ * come in. A worker takes from the back of its own queue and, when that's
+ * empty, steals from the front of the others, so long jobs don't leave
+ * cores idle at the end of a batch
+ */
+class ThreadPool {
+public:
+  /**
+   * @param threads workers, 0 = one per core
+   */
+  explicit ThreadPool(size_t threads = 0) {
+    if (threads == 0) {
+      threads = std::thread::hardware_concurrency();
+      threads = threads == 0 ? 1 : threads;
+    }
+    for (size_t i = 0; i < threads; i++) {
+      queues_.emplace_back(new Queue);
+    }
+    for (size_t i = 0; i < threads; i++) {
+      workers_.emplace_back(&ThreadPool::work, this, i);
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /**
+   * Call from one thread only, eg the one that made the pool
+   *
+   * @param job called once, on one of the workers
+   */
+  void Submit(std::function<void()> job) {
+    // counted first, so a worker can't take it before it's counted
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_++;
+      queued_++;
+    }
+    Queue &queue = *queues_[next_++ % queues_.size()];
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.jobs.push_back(std::move(job));
+    }
+    wake_.notify_one();
+  }
+
+  // blocks until every submitted job is done
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+  }
+
+  size_t GetThreads() const { return workers_.size(); }
+
+  // jobs a worker took from another worker's queue
+  size_t GetSteals() const { return steals_; }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> jobs;
+  };
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  size_t next_ = 0;
+  std::atomic<size_t> steals_{0};
+
+  // pending_ counts jobs submitted and not finished yet, queued_ the ones
+  // not taken by a worker yet
+  std::mutex mutex_;
+  std::condition_variable wake_, done_;
+  size_t pending_ = 0, queued_ = 0;
+  bool stop_ = false;
+
+  // own queue first, newest job, then the oldest job of any other queue
+  bool take(size_t self, std::function<void()> &job) {
+    {
+      Queue &queue = *queues_[self];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.jobs.empty()) {
+        job = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+        taken();
+        return true;
+      }
+    }
+    for (size_t i = 1; i < queues_.size(); i++) {
+      Queue &queue = *queues_[(self + i) % queues_.size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.jobs.empty()) {
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+        steals_++;
+        taken();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void taken() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queued_--;
+  }
+
+  void work(size_t self) {
+    std::function<void()> job;
+    while (true) {
+      if (take(self, job)) {
+        job();
+        job = nullptr;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0) {
+          done_.notify_all();
+        }
+        continue;
+      }
+      // sleep until there's something to take, queued_ is counted under
+      // the same lock Submit takes so no wake up is lost
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [this] { return stop_ || queued_ > 0; });
+      if (stop_ && queued_ == 0) {
+        return;
+      }
+    }
+  }
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+/**
+ * Writes 32 bit float WAV files, little endian hosts only (x86, ARM)
+ *
+ * @param path file to write
+ * @param samples interleaved
+ * @param frames samples per channel
+ * @return bool false if the file can't be written
+ */
+inline bool WriteWav(const char *path, const float *samples, size_t frames,
+                     uint16_t channels, uint32_t sr) {
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+  uint32_t dataSize = frames * channels * sizeof(float);
+  uint32_t riffSize = 36 + dataSize;
+  uint32_t fmtSize = 16;
+  // 3 = IEEE float
+  uint16_t format = 3;
+  uint32_t byteRate = sr * channels * sizeof(float);
+  uint16_t blockAlign = channels * sizeof(float);
+  uint16_t bits = 32;
+
+  bool ok = fwrite("RIFF", 1, 4, file) == 4;
+  ok = ok && fwrite(&riffSize, 4, 1, file) == 1;
+  ok = ok && fwrite("WAVEfmt ", 1, 8, file) == 8;
+  ok = ok && fwrite(&fmtSize, 4, 1, file) == 1;
+  ok = ok && fwrite(&format, 2, 1, file) == 1;
+  ok = ok && fwrite(&channels, 2, 1, file) == 1;
+  ok = ok && fwrite(&sr, 4, 1, file) == 1;
+  ok = ok && fwrite(&byteRate, 4, 1, file) == 1;
+  ok = ok && fwrite(&blockAlign, 2, 1, file) == 1;
+  ok = ok && fwrite(&bits, 2, 1, file) == 1;
+  ok = ok && fwrite("data", 1, 4, file) == 4;
+  ok = ok && fwrite(&dataSize, 4, 1, file) == 1;
+  ok = ok && fwrite(samples, sizeof(float), frames * channels, file) ==
+                 frames * channels;
+  return fclose(file) == 0 && ok;
+}
+
+// raw interleaved 32 bit floats, no header
+inline bool WriteRaw(const char *path, const float *samples, size_t count) {
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+  bool ok = fwrite(samples, sizeof(float), count, file) == count;
+  return fclose(file) == 0 && ok;
+}